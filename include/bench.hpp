@@ -4,12 +4,16 @@
 #include <cstdint>
 #include <vector>
 
+#include "transposition_table.hpp"
+
 struct BenchFlags {
     bool verbose;
     bool fast;
     bool phased;
     bool movegen_only;
     bool engine_only;
+    bool tt_only;
+    bool search_only;
 };
 
 struct MovegenBenchResult {
@@ -32,13 +36,32 @@ struct EngineBenchResult {
     std::vector<EngineFailure> failures;
 };
 
+struct TTBenchResult {
+    size_t positions_tested;
+    uint64_t total_nodes;
+    TTStats stats;
+    int average_hashfull;
+};
+
+struct SearchBenchResult {
+    size_t positions_tested;
+    uint64_t total_nodes;
+    double total_seconds;
+};
+
 struct BenchResults {
     MovegenBenchResult movegen;
     EngineBenchResult engine;
+    TTBenchResult tt;
+    SearchBenchResult search;
     bool ran_movegen;
     bool ran_engine;
+    bool ran_tt;
+    bool ran_search;
 };
 
 MovegenBenchResult run_movegen_bench(bool verbose, bool fast, bool phased);
 EngineBenchResult run_engine_bench(bool verbose, bool fast);
+TTBenchResult run_tt_bench(bool fast);
+SearchBenchResult run_search_bench(bool fast);
 BenchResults run_bench(const BenchFlags& flags);
\ No newline at end of file
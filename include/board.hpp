@@ -75,8 +75,17 @@ public:
     void debug();
     void make_move(Move move);
     void unmake_move(Move move);
+    void make_null_move();
+    void unmake_null_move();
+    uint64_t key_after(Move move) const;
+    bool is_square_attacked(Square square, Color by) const;
     bool in_check() const;
 
+    // Whether the color has any pieces other than pawns and the king
+    bool has_non_pawn_material(Color color) const {
+        return pieces[color][KNIGHT] | pieces[color][BISHOP] | pieces[color][ROOK] | pieces[color][QUEEN];
+    }
+
 private:
 
     // ### HELPERS
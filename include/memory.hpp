@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "types.hpp"
+
+struct LargePageAllocation {
+    void* ptr = nullptr;
+    size_t size = 0;
+    PageMode mode = REGULAR_PAGES;
+};
+
+// Allocates a block of memory aligned to the given alignment (must be a power of two)
+// Returns nullptr if the allocation fails
+void* allocate_aligned(size_t alignment, size_t size);
+
+// Frees a block of memory returned by allocate_aligned
+void free_aligned(void* ptr);
+
+// Allocates a block of memory backed by 2 MB pages when possible. Large tables that are
+// accessed randomly (transposition table, attack tables) miss the TLB on almost every
+// access with 4 KB pages. Tries reserved huge pages first, then transparent huge pages,
+// and falls back to regular pages. The pointer is nullptr if the allocation fails.
+LargePageAllocation allocate_large_pages(size_t size);
+
+// Frees a block of memory returned by allocate_large_pages
+void free_large_pages(LargePageAllocation& allocation);
+
+// A named shared memory segment mapped into this process
+struct SharedMemoryMapping {
+    void* ptr = nullptr;
+    size_t size = 0;
+    PageMode mode = REGULAR_PAGES;
+    bool created = false; // Whether this process created the segment (it is zero filled)
+};
+
+// Maps the named POSIX shared memory segment (e.g. "/enigma"), creating it with the given
+// size if it doesn't exist yet. An existing segment keeps its size, which is returned in
+// the mapping. The segment outlives the process until it is removed with
+// remove_shared_memory (or the system restarts). The pointer is nullptr if the segment
+// can't be mapped or shared memory isn't supported on this platform.
+SharedMemoryMapping map_shared_memory(const std::string& name, size_t size);
+
+// Unmaps a segment mapped by map_shared_memory (the segment itself is kept)
+void unmap_shared_memory(SharedMemoryMapping& mapping);
+
+// Removes the named segment. Processes that have it mapped keep their mapping.
+bool remove_shared_memory(const std::string& name);
+
+const char* page_mode_name(PageMode mode);
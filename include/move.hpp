@@ -10,7 +10,6 @@
 
 struct Move {
     uint16_t move;
-    // bool is_killer = false;
 
     constexpr Move() : move(0) {}
 
@@ -25,6 +24,9 @@ struct Move {
     constexpr MoveFlag flag() const { return (move >> 13) & 7; }
     constexpr bool is_promotion() const { return flag() >= 3; }
 
+    // Captures and promotions change the material balance (quiet moves don't)
+    constexpr bool is_tactical() const { return type() == CAPTURE || is_promotion(); }
+
     // Comparison operators
     constexpr bool operator==(const Move& other) const { return move == other.move; }
     constexpr bool operator!=(const Move& other) const { return move != other.move; }
@@ -35,3 +37,6 @@ constexpr Move NULL_MOVE = Move();
 
 // Killer move type definition
 using KillerMove = std::array<Move, MAX_PLY>;
+
+// countermoves[color][piece][to] of the opponent's last move
+using CounterMoveTable = std::array<std::array<std::array<Move, NUM_SQUARES>, NUM_PIECES>, NUM_COLORS>;
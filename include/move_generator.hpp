@@ -47,8 +47,9 @@ struct MoveList {
 };
 
 // Expose this function since it's used in board.cpp as well
+// Takes the occupancy explicitly so that callers can look through pieces (see.cpp)
 template <Piece P>
-inline Bitboard generate_sliding_attack_mask(const Board& b, Square from) {
+inline Bitboard generate_sliding_attack_mask(Bitboard occupied, Square from) {
     // Assign constants based on sliding piece type
     constexpr auto& attack_table = P == BISHOP ? BISHOP_ATTACK_TABLE : ROOK_ATTACK_TABLE; 
     constexpr auto& blocker_map  = P == BISHOP ? BISHOP_BLOCKER_MAP : ROOK_BLOCKER_MAP;
@@ -57,11 +58,16 @@ inline Bitboard generate_sliding_attack_mask(const Board& b, Square from) {
         
     // Look up sliding piece attacks from attack table based on blocker pattern
     Bitboard blocker_mask = blocker_map[from];
-    Bitboard blockers = b.occupied & blocker_mask;
+    Bitboard blockers = occupied & blocker_mask;
     size_t index = get_attack_table_index(blockers, blocker_mask, magic[from]);
     return attack_table[offset[from] + index];
 }
 
+template <Piece P>
+inline Bitboard generate_sliding_attack_mask(const Board& b, Square from) {
+    return generate_sliding_attack_mask<P>(b.occupied, from);
+}
+
 // Generates moves into provided MoveList using precomputed CheckInfo
 // Use this to avoid recomputing CheckInfo or reallocating MoveList across multiple calls
 template <Color C, MoveGenMode M>
@@ -69,4 +75,8 @@ void generate_moves_impl(Board& b, MoveList& moves, CheckInfo& checkInfo);
 
 // Convenience wrapper that computes CheckInfo and returns a new MoveList
 template <MoveGenMode M>
-MoveList generate_moves(Board& b);
\ No newline at end of file
+MoveList generate_moves(Board& b);
+
+// Checks if a move that wasn't produced by the move generator (e.g. a move from the
+// transposition table) is legal in the current position
+bool is_legal_move(Board& b, Move move);
\ No newline at end of file
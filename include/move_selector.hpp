@@ -1,12 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 
 #include "types.hpp"
 #include "move.hpp"
 #include "check_info.hpp"
 #include "move_generator.hpp"
 #include "search_state.hpp"
+#include "see.hpp"
 
 // Indexed like CAPTURE_SCORE[attacker][victim]
 // Incentivizes capturing high value pieces with low value pieces
@@ -19,131 +21,189 @@ constexpr std::array<std::array<MoveScore, NUM_PIECES>, NUM_PIECES> CAPTURE_SCOR
     {101, 201, 301, 401, 501, 000},
 }};
 
-struct MoveSelector {
-    MoveSelectorPhase phase;
-    CheckInfo checkInfo;
-    MoveList captures;
-    MoveList quiet_moves;
-    int killer_count;
-
-    MoveSelector(Board& b) {
-        phase = TRANSPOSITION;
-        killer_count = 0;
-
-        if (b.to_move == WHITE) checkInfo.compute_check_info<WHITE>(b);
-        else                    checkInfo.compute_check_info<BLACK>(b);
+// Queen promotions are tried before any capture (under-promotions are almost never good)
+constexpr int QUEEN_PROMOTION_SCORE = 1000;
+
+// The countermove is tried before the other quiet moves (the history scores of a quiet move
+// add up from four tables)
+constexpr int COUNTERMOVE_SCORE = 4 * MAX_HISTORY + 1;
+
+// The moves of one phase with their ordering scores
+// Instead of sorting the whole list, each call picks the best remaining move (selection
+// sort, one pass at a time). A cutoff usually comes within the first few moves, so most of
+// the list is never sorted.
+struct ScoredMoveList {
+    MoveList moves;
+    std::array<int, MAX_MOVES> scores;
+    int next = 0;
+    bool generated = false;
+
+    Move pick_best() {
+        if (next == moves.size) return NULL_MOVE;
+
+        int best = next;
+        for (int i = next + 1; i < moves.size; i++) {
+            if (scores[i] > scores[best]) best = i;
+        }
+
+        std::swap(moves[next], moves[best]);
+        std::swap(scores[next], scores[best]);
+        return moves[next++];
     }
+};
+
+// Hands out the moves of a node one at a time, best first, generating them in stages
+// (hash move, winning/equal captures, killers, quiet moves, losing captures). Each stage is
+// only generated once the previous one is used up, so nodes that cut off early never
+// generate the rest.
+// All moves are legal: the hash move and killers are validated before they are returned.
+struct MoveSelector {
+    MoveSelectorPhase phase = TRANSPOSITION;
+
+    // The hash move must already be validated (see is_legal_move), or NULL_MOVE
+    // Captures only mode (quiescence search) only hands out captures and promotions, and
+    // skips the ones that lose material (a quiescence search can't gain anything from them)
+    MoveSelector(Move tt_move, int ply, bool captures_only = false) :
+        tt_move(tt_move), ply(ply), captures_only(captures_only) {}
 
     Move next_move(Board& b, SearchState& ss) {
+        Move move;
+
         switch (phase) {
             case TRANSPOSITION:
-                // No TT right now - TODO
-
-                // If no TT moves, change phase and fall through
+                // The hash move is tried before generating anything
                 phase = GOOD_CAPTURE;
+                if (tt_move != NULL_MOVE && (!captures_only || tt_move.is_tactical())) {
+                    return tt_move;
+                }
+                [[fallthrough]];
+
             case GOOD_CAPTURE:
-                // If we just entered the capture phase, generate all captures
-                if (captures.size == 0) generate_captures(b);
+                if (!captures.generated) generate_captures(b);
+
+                while ((move = captures.pick_best()) != NULL_MOVE) {
+                    if (move == tt_move) continue;
+
+                    // Captures that lose material are tried after the quiet moves
+                    if (!see_ge(b, move, 0)) {
+                        bad_captures.add(move);
+                        continue;
+                    }
 
-                // Moves are already sorted by score when generated, so we can pop the next best move
-                Move next_cap = captures.pop();
-                if (next_cap != NULL_MOVE) {
-                    return next_cap;
+                    return move;
                 }
 
                 // If we don't have anymore captures, change phase and fall through
+                if (captures_only) {
+                    phase = NO_MOVES_LEFT;
+                    return NULL_MOVE;
+                }
                 phase = KILLER;
+                [[fallthrough]];
+
             case KILLER:
-                // We can generate quiet moves in the killer phase
-                // This will be used to determine if the killer move is legal in this position
-                if (quiet_moves.size == 0) generate_quiet_moves(b, ss);
-
-                Move killer_move_1 = ss.killer_1[b.ply];
-                Move killer_move_2 = ss.killer_2[b.ply];
-
-                // Killer count is used to track which killer we've already tried, if any
-                if (killer_count == 0 && mark_killer_if_legal(killer_move_1)) {
-                    killer_count++;
-                    return killer_move_1;
-                } else if (killer_count == 1 && mark_killer_if_legal(killer_move_2)) {
-                    killer_count++;
-                    return killer_move_2;
+                // Killers come from sibling nodes, so they need to be validated here
+                while (killer_index < 2) {
+                    Move killer = killer_index == 0 ? ss.killer_1[ply] : ss.killer_2[ply];
+                    if (
+                        killer != NULL_MOVE
+                        && killer != tt_move
+                        && !killer.is_tactical()
+                        && is_legal_move(b, killer)
+                    ) {
+                        killers[killer_index++] = killer;
+                        return killer;
+                    }
+                    killer_index++;
                 }
 
                 // If we've tried both killers already or don't have any, fall through to the next phase
                 phase = QUIET_MOVE;
+                [[fallthrough]];
+
             case QUIET_MOVE:
-                Move next_quiet = quiet_moves.pop();
-                while (next_quiet != NULL_MOVE && next_quiet.is_killer) {
-                    next_quiet = quiet_moves.pop();
-                }
+                if (!quiet_moves.generated) generate_quiet_moves(b, ss);
 
-                if (next_quiet != NULL_MOVE) {
-                    return next_quiet;
+                while ((move = quiet_moves.pick_best()) != NULL_MOVE) {
+                    if (move != tt_move && move != killers[0] && move != killers[1]) return move;
                 }
 
                 phase = BAD_CAPTURE;
+                [[fallthrough]];
+
             case BAD_CAPTURE:
-                // No SEE yet - TODO
-            default: 
+                // Already in MVV-LVA order since they were set aside while picking the captures
+                if (bad_capture_index < bad_captures.size) {
+                    return bad_captures[bad_capture_index++];
+                }
+
+                phase = NO_MOVES_LEFT;
+                [[fallthrough]];
+
+            default:
                 return NULL_MOVE;
         }
     }
 
 private:
+    Move tt_move;
+    int ply;
+    bool captures_only;
 
-    inline void generate_captures(Board& b) {
-        if (b.to_move == WHITE) generate_moves_impl<WHITE, CAPTURES_AND_PROMOTIONS>(b, captures, checkInfo);
-        else                    generate_moves_impl<BLACK, CAPTURES_AND_PROMOTIONS>(b, captures, checkInfo);
+    // Computed once, when the first stage is generated
+    CheckInfo check_info;
+    bool check_info_computed = false;
 
-        sort_captures(b);
-    }
+    ScoredMoveList captures;
+    ScoredMoveList quiet_moves;
+    MoveList bad_captures;
+    int bad_capture_index = 0;
 
-    inline void generate_quiet_moves(Board& b, SearchState& ss) {
-        if (b.to_move == WHITE) generate_moves_impl<WHITE, QUIET_ONLY>(b, quiet_moves, checkInfo);
-        else                    generate_moves_impl<BLACK, QUIET_ONLY>(b, quiet_moves, checkInfo);
+    // Killers that were handed out (so they're skipped among the quiet moves)
+    std::array<Move, 2> killers = {NULL_MOVE, NULL_MOVE};
+    int killer_index = 0;
+
+    inline void compute_check_info(Board& b) {
+        if (check_info_computed) return;
 
-        sort_quiet_moves(b, ss);
+        if (b.to_move == WHITE) check_info.compute_check_info<WHITE>(b);
+        else                    check_info.compute_check_info<BLACK>(b);
+        check_info_computed = true;
     }
 
-    inline void sort_captures(Board& b) {
-        std::sort(captures.begin(), captures.end(), [&b](Move m1, Move m2) {
-            Piece m1_from_piece = b.piece_map[m1.from()];
-            Piece m1_to_piece = b.piece_map[m1.to()];
-            MoveScore m1_score = CAPTURE_SCORE[m1_from_piece][m1_to_piece];
+    inline void generate_captures(Board& b) {
+        compute_check_info(b);
 
-            Piece m2_from_piece = b.piece_map[m2.from()];
-            Piece m2_to_piece = b.piece_map[m2.to()];
-            MoveScore m2_score = CAPTURE_SCORE[m2_from_piece][m2_to_piece];
+        if (b.to_move == WHITE) generate_moves_impl<WHITE, CAPTURES_AND_PROMOTIONS>(b, captures.moves, check_info);
+        else                    generate_moves_impl<BLACK, CAPTURES_AND_PROMOTIONS>(b, captures.moves, check_info);
+        captures.generated = true;
 
-            return m1_score < m2_score;
-        });
+        for (int i = 0; i < captures.moves.size; i++) {
+            captures.scores[i] = score_capture(b, captures.moves[i]);
+        }
     }
 
-    inline void sort_quiet_moves(Board& b, SearchState& ss) {
-        std::sort(quiet_moves.begin(), quiet_moves.end(), [&b, &ss](Move m1, Move m2) {
-            Square m1_from = m1.from();
-            Square m1_to = m1.to();
-            Piece m1_piece = b.piece_map[m1_from];
-            MoveScore m1_score = ss.color_piece_to[b.to_move][m1_piece][m1_to] + ss.from_to[m1_from][m1_to];
+    inline void generate_quiet_moves(Board& b, SearchState& ss) {
+        compute_check_info(b);
 
-            Square m2_from = m2.from();
-            Square m2_to = m2.to();
-            Piece m2_piece = b.piece_map[m2_from];
-            MoveScore m2_score = ss.color_piece_to[b.to_move][m2_piece][m2_to] + ss.from_to[m2_from][m2_to];
+        if (b.to_move == WHITE) generate_moves_impl<WHITE, QUIET_ONLY>(b, quiet_moves.moves, check_info);
+        else                    generate_moves_impl<BLACK, QUIET_ONLY>(b, quiet_moves.moves, check_info);
+        quiet_moves.generated = true;
 
-            return m1_score < m2_score;
-        });
+        Move countermove = ss.countermove(b);
+        for (int i = 0; i < quiet_moves.moves.size; i++) {
+            Move move = quiet_moves.moves[i];
+            quiet_moves.scores[i] = move == countermove ? COUNTERMOVE_SCORE : ss.quiet_history(b, ply, move);
+        }
     }
 
-    inline bool mark_killer_if_legal(Move killer_move) {
-        for (Move& move : quiet_moves) {
-            if (move == killer_move) {
-                move.is_killer = true;
-                return true;
-            }
-        }
+    // MVV-LVA (most valuable victim, least valuable attacker), with queen promotions first
+    static inline int score_capture(const Board& b, Move move) {
+        Piece attacker = b.piece_map[move.from()];
+        Piece victim = captured_piece(b, move);
 
-        return false;
+        int score = victim == NO_PIECE ? 0 : CAPTURE_SCORE[attacker][victim];
+        if (move.flag() == PROMOTION_QUEEN) score += QUEEN_PROMOTION_SCORE;
+        return score;
     }
-};
\ No newline at end of file
+};
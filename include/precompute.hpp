@@ -3,12 +3,14 @@
 #include <bit>
 #include <vector>
 #include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <span>
 
 #include "types.hpp"
 #include "utils.hpp"
 #include "random.hpp"
+#include "memory.hpp"
 
 using AttackMap         = std::array<Bitboard, NUM_SQUARES>;
 using BlockerMap        = std::array<Bitboard, NUM_SQUARES>;
@@ -162,8 +164,23 @@ static constexpr std::array<size_t, NUM_SQUARES> compute_offset(const BlockerMap
 constexpr auto BISHOP_OFFSET = compute_offset(BISHOP_BLOCKER_MAP);
 constexpr auto ROOK_OFFSET = compute_offset(ROOK_BLOCKER_MAP);
 
-static inline const auto _BISHOP_ATTACK_TABLE = []() {
-    std::array<Bitboard, BISHOP_ATTACK_TABLE_SIZE> table{};
+// Both attack tables live in one block of memory backed by huge pages (when available)
+// since slider attack lookups access them randomly and would otherwise miss the TLB
+inline const LargePageAllocation ATTACK_TABLE_MEMORY = []() {
+    LargePageAllocation memory = allocate_large_pages(
+        (BISHOP_ATTACK_TABLE_SIZE + ROOK_ATTACK_TABLE_SIZE) * sizeof(Bitboard)
+    );
+    // The engine can't run without the attack tables, so don't try to build them in null memory
+    if (memory.ptr == nullptr) {
+        std::clog << "Error: Failed to allocate attack tables\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return memory;
+}();
+
+// Attack tables are exposed as std::span since they have different sizes
+inline const std::span<const Bitboard> BISHOP_ATTACK_TABLE = []() {
+    Bitboard* table = static_cast<Bitboard*>(ATTACK_TABLE_MEMORY.ptr);
     for (Square sq = 0; sq < NUM_SQUARES; sq++) {
         Bitboard blocker_mask = BISHOP_BLOCKER_MAP[sq];
 
@@ -192,12 +209,13 @@ static inline const auto _BISHOP_ATTACK_TABLE = []() {
         };
     }
 
-    return table;
+    return std::span<const Bitboard>(table, BISHOP_ATTACK_TABLE_SIZE);
 }();
 
-static inline const auto _ROOK_ATTACK_TABLE = []() {
+inline const std::span<const Bitboard> ROOK_ATTACK_TABLE = []() {
     // Same logic as bishop attack table but using rook constants
-    std::array<Bitboard, ROOK_ATTACK_TABLE_SIZE> table{};
+    // The rook table is placed right after the bishop table
+    Bitboard* table = static_cast<Bitboard*>(ATTACK_TABLE_MEMORY.ptr) + BISHOP_ATTACK_TABLE_SIZE;
     for (Square sq = 0; sq < NUM_SQUARES; sq++) {
         Bitboard blocker_mask = ROOK_BLOCKER_MAP[sq];
         int num_blockers = std::popcount(blocker_mask);
@@ -218,13 +236,9 @@ static inline const auto _ROOK_ATTACK_TABLE = []() {
         }
     }
 
-    return table;
+    return std::span<const Bitboard>(table, ROOK_ATTACK_TABLE_SIZE);
 }();
 
-// Expose attack tables as std::span since they have different types due to different sizes
-inline const std::span<const Bitboard> BISHOP_ATTACK_TABLE{_BISHOP_ATTACK_TABLE};
-inline const std::span<const Bitboard> ROOK_ATTACK_TABLE{_ROOK_ATTACK_TABLE};
-
 // This function is used to compute magic numbers which are useful for generating
 // indices for rook and bishop attack tables.
 // Note that the source code contains hardcoded values generated using this function,
@@ -2,20 +2,31 @@
 
 #include <random>
 #include <cstdint>
-#include <bit>
 
-static std::random_device rd;
-static std::mt19937_64 gen(rd());
+// SplitMix64 pseudo random number generator. Unlike std::mt19937_64, it can run at
+// compile time, so it's used to generate the Zobrist keys with a fixed seed. This keeps
+// the keys identical across runs and binaries.
+struct PRNG {
+    uint64_t state;
 
-static std::uniform_int_distribution<uint64_t> u64_dist(
-    0, std::numeric_limits<uint64_t>::max()
-);
+    constexpr explicit PRNG(uint64_t seed) : state(seed) {}
 
-inline uint64_t random_u64() {
-    return u64_dist(gen);
-}
+    constexpr uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
 
 // Returns a random sparse uint64_t
+// Uses a nondeterministic generator since it's only used to search for magic numbers
 inline uint64_t random_magic() {
+    static std::random_device rd;
+    static std::mt19937_64 gen(rd());
+    static std::uniform_int_distribution<uint64_t> u64_dist(
+        0, std::numeric_limits<uint64_t>::max()
+    );
+
     return u64_dist(gen) & u64_dist(gen) & u64_dist(gen);
-}
\ No newline at end of file
+}
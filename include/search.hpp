@@ -1,23 +1,128 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "board.hpp"
 #include "search_state.hpp"
+#include "transposition_table.hpp"
+#include "time_manager.hpp"
+
+// Forward declaration (defined in search.cpp)
+struct SearchWorker;
+
+// Owns everything needed to run a search: the transposition table, the search threads
+// (each with their own SearchState) and the stop flag. Independent searchers can run
+// concurrently in the same process since they share nothing but the precomputed tables.
+class Searcher {
+public:
+    // Set to stop the current search (e.g. via UCI stop)
+    std::atomic<bool> stop_requested = false;
+
+    Searcher();
+    ~Searcher();
+
+    template <SearchMode SM>
+    Move search(Board& b, const SearchLimits& limits);
+
+    Move search_time(Board& b, int time) {
+        return search<TIME>(b, {.time = time});
+    }
+
+    // Timed search that decides how much of the clock to use (see TimeManager)
+    Move search_clock(Board& b, const TimeControl& clock) {
+        return search<TIME>(b, {.clock = clock});
+    }
+
+    Move search_nodes(Board& b, uint64_t nodes) {
+        return search<NODES>(b, {.nodes = nodes});
+    }
+
+    Move search_depth(Board& b, SearchDepth depth) {
+        return search<DEPTH>(b, {.depth = depth});
+    }
+
+    Move search_infinite(Board& b) {
+        return search<INFINITE>(b, {});
+    }
+
+    // Sets the number of threads used by the search (main thread + helpers)
+    // Helpers share the transposition table with the main thread (Lazy SMP)
+    void set_threads(int threads);
+
+    // Resizes the transposition table (in megabytes)
+    bool set_hash(size_t mb);
+
+    size_t hash_size_mb() const {
+        return tt.size_mb();
+    }
+
+    PageMode hash_page_mode() const {
+        return tt.page_mode();
+    }
+
+    void clear_hash();
+
+    // Clears the killers and history tables of all search threads (e.g. on a new game)
+    void clear_history();
+
+    // Nodes searched by all threads in the last search
+    uint64_t nodes() const {
+        return total_nodes();
+    }
+
+    // Permille of the transposition table filled by the current search (UCI hashfull)
+    int hashfull() const {
+        return tt.hashfull();
+    }
+
+    // Transposition table statistics of the last search, summed over all threads
+    TTStats tt_stats() const;
+
+    // Principal variation of the last search (from the thread whose best move was picked)
+    const PrincipalVariation& principal_variation() const {
+        return pv;
+    }
+
+    // Shares the transposition table with other processes through the named shared
+    // memory segment (an empty name makes it private again)
+    bool share_hash(const std::string& name) {
+        return tt.share(name, num_threads);
+    }
+
+    bool hash_is_shared() const {
+        return tt.is_shared();
+    }
+
+    bool remove_shared_hash() {
+        return tt.remove_shared();
+    }
+
+    // Saves the transposition table to a file / loads it back (see TranspositionTable::load)
+    bool save_hash(const std::string& path) const {
+        return tt.save(path);
+    }
+
+    bool load_hash(const std::string& path) {
+        return tt.load(path, num_threads);
+    }
 
-template <SearchMode SM>
-Move search(Board& b, const SearchLimits& limits);
+private:
+    friend struct SearchWorker;
 
-inline Move search_time(Board& b, int time) {
-    return search<TIME>(b, {.time = time});
-}
+    TranspositionTable tt;
+    TimeManager time_manager;
+    SearchLimits limits;
+    int num_threads = 1;
+    PrincipalVariation pv;
 
-inline Move search_nodes(Board& b, uint64_t nodes) {
-    return search<NODES>(b, {.nodes = nodes});
-}
+    // All workers taking part in the current search (index 0 is the main thread)
+    std::vector<std::unique_ptr<SearchWorker>> workers;
 
-inline Move search_depth(Board& b, SearchDepth depth) {
-    return search<DEPTH>(b, {.depth = depth});
-}
+    // Set by the main thread once it finishes its search to stop the helper threads
+    std::atomic<bool> stop_helpers = false;
 
-inline Move search_infinite(Board& b) {
-    return search<INFINITE>(b, {});
-}
\ No newline at end of file
+    uint64_t total_nodes() const;
+};
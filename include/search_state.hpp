@@ -1,22 +1,78 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <utility>
 
 #include "types.hpp"
 #include "move.hpp"
+#include "board.hpp"
+#include "transposition_table.hpp"
+#include "time_manager.hpp"
 
 struct SearchLimits {
-    int time;
+    int time;          // Fixed time per move (used if there is no clock)
     uint64_t nodes;
     SearchDepth depth;
+    TimeControl clock;
 };
 
+// Information about a node on the current search path
+struct SearchStackEntry {
+    PositionScore static_eval = DUMMY_SCORE; // DUMMY_SCORE if in check (no static eval)
+
+    // The move currently being searched from this node (NULL_MOVE for a null move) and the
+    // piece making it, which give the context of the continuation history in the child nodes
+    Move move = NULL_MOVE;
+    Piece moved_piece = NO_PIECE;
+
+    // Move skipped while checking whether it's singular (see negamax)
+    Move excluded_move = NULL_MOVE;
+};
+
+// Indexed by the ply from the root of the search (not from the start of the game)
+using SearchStack = std::array<SearchStackEntry, MAX_PLY>;
+
+// The line of best moves from a node, as far as the search has proven it
+struct PrincipalVariation {
+    std::array<Move, MAX_PLY> moves;
+    int length = 0;
+
+    // This line becomes move followed by the line of the position after it
+    inline void update(Move move, const PrincipalVariation& child) {
+        moves[0] = move;
+        std::copy_n(child.moves.begin(), child.length, moves.begin() + 1);
+        length = child.length + 1;
+    }
+};
+
+// Triangular PV table: the line of the node at each ply from the root, which each node builds
+// from its best move and the line of the child at the next ply. Indexed like SearchStack
+// (with room for the empty line of the children of the deepest nodes)
+using PVTable = std::array<PrincipalVariation, MAX_PLY + 1>;
+
 struct SearchState {
     SearchLimits limits;
+    std::chrono::steady_clock::time_point start_time;
     std::chrono::steady_clock::time_point deadline; 
-    uint64_t nodes = 0;
     bool search_interrupted = false;
 
+    // Node counter - atomic so the main thread can sum node counts across all
+    // threads while they are still searching. Only the owning thread writes to it
+    std::atomic<uint64_t> nodes = 0;
+
+    // Board ply at the root, so that ply - root_ply is the distance from the root
+    int root_ply = 0;
+    SearchStack stack{};
+    PVTable pv_table{};
+
+    // Transposition table usage (only read once the search is over)
+    TTStats tt_stats;
+
     // Killer moves
     KillerMove killer_1;
     KillerMove killer_2;
@@ -24,4 +80,145 @@ struct SearchState {
     // History heuristic tables (for quiet moves)
     ColorPieceToHistory color_piece_to{};
     FromToHistory from_to{};
-};
\ No newline at end of file
+
+    // History of quiet moves following the moves one and two plies before them
+    ContinuationHistory continuation_history{};
+
+    // Quiet moves that refuted the opponent's last move
+    CounterMoveTable countermoves{};
+
+    // Records the move being searched at ply (before it's made)
+    inline void set_current_move(const Board& b, int ply, Move move) {
+        stack[ply].move = move;
+        stack[ply].moved_piece = move == NULL_MOVE ? static_cast<Piece>(NO_PIECE) : b.piece_map[move.from()];
+    }
+
+    // Quiet move that caused a beta cutoff at this ply (the previous one becomes the second killer)
+    inline void update_killers(int ply, Move move) {
+        if (killer_1[ply] == move) return;
+        killer_2[ply] = killer_1[ply];
+        killer_1[ply] = move;
+    }
+
+    // Sum of all history scores of a quiet move at ply (used for ordering and reductions)
+    inline int quiet_history(const Board& b, int ply, Move move) const {
+        Square from = move.from();
+        Square to = move.to();
+        Piece piece = b.piece_map[from];
+
+        int score = color_piece_to[b.to_move][piece][to] + from_to[from][to];
+        for (int plies_ago : {1, 2}) {
+            const ColorPieceToHistory* history = continuation(ply, plies_ago, b.to_move);
+            if (history) score += (*history)[b.to_move][piece][to];
+        }
+        return score;
+    }
+
+    // Adds a bonus (or a penalty if negative) to a quiet move's history scores
+    // History gravity: the update shrinks as a score approaches MAX_HISTORY, which keeps scores
+    // bounded and lets moves that stop being good lose their score again
+    inline void update_history(const Board& b, int ply, Move move, int bonus) {
+        Square from = move.from();
+        Square to = move.to();
+        Piece piece = b.piece_map[from];
+
+        apply_history_bonus(color_piece_to[b.to_move][piece][to], bonus);
+        apply_history_bonus(from_to[from][to], bonus);
+        for (int plies_ago : {1, 2}) {
+            ColorPieceToHistory* history = continuation(ply, plies_ago, b.to_move);
+            if (history) apply_history_bonus((*history)[b.to_move][piece][to], bonus);
+        }
+    }
+
+    // Quiet move that last refuted the opponent's last move (NULL_MOVE if there is none)
+    inline Move countermove(const Board& b) const {
+        const Move* entry = countermove_entry(b);
+        return entry ? *entry : NULL_MOVE;
+    }
+
+    inline void update_countermove(const Board& b, Move move) {
+        Move* entry = countermove_entry(b);
+        if (entry) *entry = move;
+    }
+
+    // Called at the start of every search: killers are indexed by the ply from the root, so
+    // they don't carry over, but the history is still a good guide (with less weight)
+    inline void age_history() {
+        killer_1.fill(NULL_MOVE);
+        killer_2.fill(NULL_MOVE);
+
+        for (auto& piece_to : color_piece_to) {
+            for (auto& to : piece_to) {
+                for (HistoryScore& score : to) score /= 2;
+            }
+        }
+        for (auto& to : from_to) {
+            for (HistoryScore& score : to) score /= 2;
+        }
+        for (auto& piece_to : continuation_history) {
+            for (auto& to : piece_to) {
+                for (auto& history : to) {
+                    for (auto& pieces : history) {
+                        for (auto& squares : pieces) {
+                            for (HistoryScore& score : squares) score /= 2;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Called on a new game
+    inline void clear_history() {
+        killer_1.fill(NULL_MOVE);
+        killer_2.fill(NULL_MOVE);
+        color_piece_to = {};
+        from_to = {};
+        continuation_history = {};
+        countermoves = {};
+    }
+
+    // Relaxed load + store instead of fetch_add since only one thread ever writes
+    // to the counter (avoids a locked instruction on every node)
+    inline void increment_nodes() {
+        nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+private:
+    // Continuation history table of the move made plies_ago plies before a node at ply, where
+    // color is the side to move at that node. nullptr if the move was a null move or was made
+    // before the root
+    inline const ColorPieceToHistory* continuation(int ply, int plies_ago, Color color) const {
+        if (ply < plies_ago) return nullptr;
+
+        const SearchStackEntry& entry = stack[ply - plies_ago];
+        if (entry.move == NULL_MOVE) return nullptr;
+
+        Color prev_color = plies_ago % 2 == 0 ? color : color ^ 1;
+        return &continuation_history[prev_color][entry.moved_piece][entry.move.to()];
+    }
+
+    inline ColorPieceToHistory* continuation(int ply, int plies_ago, Color color) {
+        return const_cast<ColorPieceToHistory*>(std::as_const(*this).continuation(ply, plies_ago, color));
+    }
+
+    // The countermove table entry of the opponent's last move (nullptr after a null move or if
+    // no move has been made)
+    inline const Move* countermove_entry(const Board& b) const {
+        if (b.ply == 0) return nullptr;
+
+        Move prev = b.moves[b.ply - 1];
+        if (prev == NULL_MOVE) return nullptr;
+
+        return &countermoves[b.to_move ^ 1][b.piece_map[prev.to()]][prev.to()];
+    }
+
+    inline Move* countermove_entry(const Board& b) {
+        return const_cast<Move*>(std::as_const(*this).countermove_entry(b));
+    }
+
+    static inline void apply_history_bonus(HistoryScore& score, int bonus) {
+        bonus = std::clamp(bonus, -MAX_HISTORY, MAX_HISTORY);
+        score += bonus - score * std::abs(bonus) / MAX_HISTORY;
+    }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "types.hpp"
+#include "board.hpp"
+#include "move.hpp"
+
+// Static exchange evaluation: the material balance (from the side to move's point of view)
+// after the sequence of captures on the destination square of a move, where each side
+// recaptures with its least valuable attacker and may stop whenever continuing would lose
+// material. Sliders behind the capturing pieces (x-rays) join the exchange as the square
+// in front of them is vacated. Pins are ignored.
+int see(const Board& b, Move move);
+
+// The piece captured by the move (NO_PIECE for quiet moves). The captured pawn of an en
+// passant capture isn't on the destination square
+inline Piece captured_piece(const Board& b, Move move) {
+    return move.flag() == EN_PASSANT ? static_cast<Piece>(PAWN) : b.piece_map[move.to()];
+}
+
+// Material won by the move itself (captured piece and promotion), before any recapture
+int material_gain(const Board& b, Move move);
+
+// Whether see(b, move) >= threshold. Cheaper than computing the exact value since it
+// stops as soon as the outcome relative to the threshold is known
+bool see_ge(const Board& b, Move move, int threshold);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "types.hpp"
+#include "move.hpp"
+
+// Time reserved per move for communication with the GUI (configurable via the UCI
+// Move Overhead option)
+constexpr int DEFAULT_MOVE_OVERHEAD_MS = 10;
+constexpr int MAX_MOVE_OVERHEAD_MS     = 5000;
+
+// The clock as given by the UCI go command (in milliseconds)
+struct TimeControl {
+    int remaining = -1;  // -1 if there is no clock (fixed time per move)
+    int increment = 0;
+    int moves_to_go = 0; // 0 if not given (the rest of the game has to be played in this time)
+    int move_overhead = DEFAULT_MOVE_OVERHEAD_MS;
+};
+
+// Decides how long a timed search runs. The hard limit aborts the search, even in the middle
+// of an iteration. The soft limit only decides whether to start another iteration (which
+// usually takes longer than all previous ones together), so most searches end well before the
+// hard limit and no partial iteration is wasted. The soft limit is scaled after every iteration:
+// searches with a stable best move that took most of the nodes stop early, while searches where
+// the best move keeps changing or the score drops get more time.
+class TimeManager {
+public:
+    // Fixed time per move (UCI movetime): both limits are the given time
+    void init(int time);
+
+    // Allocates time for the move from the clock
+    void init(const TimeControl& clock);
+
+    int hard_limit() const { return hard; }
+
+    // Called by the main thread after every completed iteration with its result and the
+    // fraction of the iteration's nodes spent on the best move. Returns whether there is
+    // enough time left to start the next iteration
+    bool should_start_iteration(int elapsed, Move best_move, PositionScore score, double best_move_nodes);
+
+private:
+    int soft = 0;
+    int hard = 0;
+
+    // The soft limit is only scaled when managing a clock
+    bool adaptive = false;
+
+    // Result of the previous iteration and the number of iterations in a row (after the first)
+    // that have found the same best move
+    Move previous_best_move;
+    PositionScore previous_score = DUMMY_SCORE;
+    int stability = 0;
+};
@@ -1,12 +1,28 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
 
 #include "types.hpp"
+#include "memory.hpp"
+#include "move.hpp"
 #include "random.hpp"
 
 // --- ZOBRIST NUMBERS ---
 
+// Zobrist keys are generated at compile time from a fixed seed so that they are the same
+// in every run and every binary (reproducible node counts and persistable hash tables)
+constexpr uint64_t ZOBRIST_SEED = 0x456E69676D61ULL; // "Enigma"
+
 const int CASTLING_RIGHTS_COMBINATIONS = 16;
 const int EN_PASSANT_TARGET_FILES = 8;
 
@@ -14,88 +30,335 @@ using ZobristPieces = std::array<std::array<std::array<uint64_t, NUM_SQUARES>, N
 using ZobristCastlingRights = std::array<uint64_t, CASTLING_RIGHTS_COMBINATIONS>;
 using ZobristEnPassantTargets = std::array<uint64_t, EN_PASSANT_TARGET_FILES>;
 
-inline const ZobristPieces ZOBRIST_PIECES = []() {
-    ZobristPieces ZOBRIST_PIECES;
+struct ZobristKeys {
+    ZobristPieces pieces{};
+    ZobristCastlingRights castling_rights{};
+    ZobristEnPassantTargets en_passant_targets{};
+    uint64_t side_to_move = 0;
+};
+
+// All keys are drawn from a single generator so that no two tables share a sequence
+inline constexpr ZobristKeys ZOBRIST_KEYS = []() {
+    PRNG rng(ZOBRIST_SEED);
+    ZobristKeys keys;
+
     for (int i = 0; i < NUM_COLORS; i++) {
         for (int j = 0; j < NUM_PIECES; j++) {
             for (int k = 0; k < NUM_SQUARES; k++) {
-                ZOBRIST_PIECES[i][j][k] = random_u64();
+                keys.pieces[i][j][k] = rng.next();
             }
         }
     }
 
-    return ZOBRIST_PIECES;
-}();
-
-inline const ZobristCastlingRights ZOBRIST_CASTLING_RIGHTS = []() {
-    ZobristCastlingRights ZOBRIST_CASTLING_RIGHTS;
     for (int i = 0; i < CASTLING_RIGHTS_COMBINATIONS; i++) {
-        ZOBRIST_CASTLING_RIGHTS[i] = random_u64();
+        keys.castling_rights[i] = rng.next();
     }
 
-    return ZOBRIST_CASTLING_RIGHTS;
-}();
-
-inline const ZobristEnPassantTargets ZOBRIST_EN_PASSANT_TARGETS = []() {
-    ZobristEnPassantTargets ZOBRIST_EN_PASSANT_TARGETS;
     for (int i = 0; i < EN_PASSANT_TARGET_FILES; i++) {
-        ZOBRIST_EN_PASSANT_TARGETS[i] = random_u64();
+        keys.en_passant_targets[i] = rng.next();
     }
 
-    return ZOBRIST_EN_PASSANT_TARGETS;
+    keys.side_to_move = rng.next();
+    return keys;
 }();
 
-inline const uint64_t ZOBRIST_SIDE_TO_MOVE = random_u64();
+inline constexpr const ZobristPieces& ZOBRIST_PIECES = ZOBRIST_KEYS.pieces;
+inline constexpr const ZobristCastlingRights& ZOBRIST_CASTLING_RIGHTS = ZOBRIST_KEYS.castling_rights;
+inline constexpr const ZobristEnPassantTargets& ZOBRIST_EN_PASSANT_TARGETS = ZOBRIST_KEYS.en_passant_targets;
+inline constexpr uint64_t ZOBRIST_SIDE_TO_MOVE = ZOBRIST_KEYS.side_to_move;
+
+// Identifies the key set so that hash files written with different keys are rejected
+inline constexpr uint64_t ZOBRIST_FINGERPRINT = []() {
+    PRNG rng(0);
+    auto mix = [&rng](uint64_t key) { rng.state ^= key; rng.next(); };
+
+    for (const auto& color : ZOBRIST_KEYS.pieces) {
+        for (const auto& piece : color) {
+            for (uint64_t key : piece) mix(key);
+        }
+    }
+    for (uint64_t key : ZOBRIST_KEYS.castling_rights) mix(key);
+    for (uint64_t key : ZOBRIST_KEYS.en_passant_targets) mix(key);
+    mix(ZOBRIST_KEYS.side_to_move);
+
+    return rng.next();
+}();
 
 // --- TRANSPOSITION TABLE ---
 
+// Entries are packed into 8 bytes so that a whole bucket fits in one cache line.
+// Instead of the full hash, only the lower 16 bits are stored as a key to verify the
+// position (the upper bits already selected the bucket).
+// Since an entry is exactly 64 bits, it is stored as a single atomic word which means
+// threads can share the table without locks and never see a half written entry.
 struct TTEntry {
-    uint64_t hash;
+    uint16_t key;
     Move best_move;
-    SearchDepth depth;
     PositionScore score;
-    TTNode node;
+    SearchDepth depth;
+    uint8_t generation_node; // Generation in the upper 6 bits, node type in the lower 2 bits
 
-    constexpr TTEntry() : 
-        hash(0), best_move(NULL_MOVE), depth(0), score(DUMMY_SCORE), node(NO_TT_ENTRY) {}
+    constexpr TTEntry() :
+        key(0), best_move(NULL_MOVE), score(0), depth(0), generation_node(0) {}
 
-    constexpr TTEntry(uint64_t hash, Move best_move, SearchDepth depth, PositionScore score, TTNode node) : 
-        hash(hash), best_move(best_move), depth(depth), score(score), node(node) {}
+    constexpr TTNode node() const { return generation_node & TT_NODE_MASK; }
+    constexpr uint8_t generation() const { return generation_node >> TT_NODE_BITS; }
+
+    static constexpr uint8_t TT_NODE_BITS = 2;
+    static constexpr uint8_t TT_NODE_MASK = (1 << TT_NODE_BITS) - 1;
 };
+static_assert(sizeof(TTEntry) == sizeof(uint64_t));
+
+constexpr int TT_BUCKET_SIZE = CACHE_LINE_SIZE / sizeof(TTEntry);
+
+// Number of entries sampled to estimate how full the table is (UCI hashfull is in permille)
+constexpr int TT_HASHFULL_SAMPLE_SIZE = 1000;
+
+// Generations wrap around after 64 searches (6 bits)
+constexpr uint8_t TT_GENERATION_MASK = 0xFF >> TTEntry::TT_NODE_BITS;
+
+// Each entry is weighted by depth - TT_AGE_WEIGHT * age when choosing which one to replace
+constexpr int TT_AGE_WEIGHT = 8;
+
+struct alignas(CACHE_LINE_SIZE) TTBucket {
+    std::array<std::atomic<uint64_t>, TT_BUCKET_SIZE> entries;
+};
+static_assert(sizeof(TTBucket) == CACHE_LINE_SIZE);
+
+// Hash files are a header followed by the buckets exactly as they are laid out in memory,
+// so loading a file is a single copy out of a memory mapping rather than a parse.
+// The header takes up a whole cache line so that the buckets stay aligned in the file.
+// Bump the version whenever the layout of TTEntry or TTBucket changes.
+constexpr char TT_FILE_MAGIC[8] = {'E', 'N', 'I', 'G', 'M', 'A', 'T', 'T'};
+constexpr uint32_t TT_FILE_VERSION = 1;
+
+struct alignas(CACHE_LINE_SIZE) TTFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t bucket_size;
+    uint64_t zobrist_fingerprint;
+    uint64_t bucket_count;
+    uint8_t generation;
+};
+static_assert(sizeof(TTFileHeader) == CACHE_LINE_SIZE);
+
+// Counters of how the search uses the table, kept per search thread
+struct TTStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;              // Probes that found an entry for the position
+    uint64_t cutoffs = 0;           // Hits deep enough with a bound that ended the search of the node
+    uint64_t deeper_overwrites = 0; // Stores that evicted a deeper entry of a different position
+    uint64_t move_mismatches = 0;   // Keys matched, but the stored move is illegal (key collision)
+
+    TTStats& operator+=(const TTStats& other) {
+        probes += other.probes;
+        hits += other.hits;
+        cutoffs += other.cutoffs;
+        deeper_overwrites += other.deeper_overwrites;
+        move_mismatches += other.move_mismatches;
+        return *this;
+    }
+};
+
+class TranspositionTable {
+public:
+    TranspositionTable(size_t mb = DEFAULT_HASH_MB);
+    ~TranspositionTable();
+
+    // The table owns its memory, so it can't be copied
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // Reallocates the table with the given size in megabytes (contents are lost)
+    // Returns false if the allocation fails, in which case the default size is used
+    // A shared table is reattached instead, keeping the contents and size of the segment
+    // if other processes are still using it
+    bool resize(size_t mb, int threads = 1);
+
+    // Zeroes the table, splitting the work across the given number of threads
+    void clear(int threads = 1);
+
+    // Moves the table into the named shared memory segment so that engine processes on the
+    // same machine can share it (same lockless scheme as between threads). The segment is
+    // created with the current size if it doesn't exist, otherwise its size is used.
+    // An empty name moves the table back to private memory. Either way the contents are
+    // lost. Returns false if the segment can't be used, in which case the table is private.
+    bool share(const std::string& name, int threads = 1);
+
+    bool is_shared() const {
+        return shared.ptr != nullptr;
+    }
+
+    // Removes the shared memory segment once every process detaches from it. The table keeps
+    // using the segment until the next resize or share, which then goes private rather than
+    // creating a new segment under the removed name
+    bool remove_shared() {
+        if (!is_shared() || shared_name.empty() || !remove_shared_memory(shared_name)) {
+            return false;
+        }
+        shared_name.clear();
+        return true;
+    }
+
+    // Writes the table to a file so that it can be reloaded in a later session
+    bool save(const std::string& path) const;
 
-struct TranspositionTable {
-    std::array<TTEntry, TRANSPOSITION_TABLE_SIZE> table;
+    // Replaces the table with one written by save. Files from a different version or key set,
+    // or of a different size than the current table, are rejected and leave the table as is.
+    bool load(const std::string& path, int threads = 1);
 
-    TranspositionTable() {
-        clear();
+    // Called at the start of every search. Entries from previous searches are kept
+    // (they are still useful), but are replaced first since they are tagged with an
+    // older generation
+    // Each process sharing a table keeps its own generation, so entries written by other
+    // processes are aged relative to this process's searches
+    void new_search() {
+        generation = (generation + 1) & TT_GENERATION_MASK;
     }
 
-    void clear() {
-        table.fill(TTEntry{});
+    // Estimates the permille of the table filled during the current search by sampling
+    // the first entries (the rest of the table is filled just as uniformly)
+    int hashfull() const {
+        constexpr uint64_t SAMPLE_BUCKETS = TT_HASHFULL_SAMPLE_SIZE / TT_BUCKET_SIZE;
+
+        int count = 0;
+        for (uint64_t i = 0; i < std::min(SAMPLE_BUCKETS, bucket_count); i++) {
+            for (const auto& slot : table[i].entries) {
+                TTEntry entry = load(slot);
+                count += entry.node() != NO_TT_ENTRY && entry.generation() == generation;
+            }
+        }
+
+        return count * 1000 / static_cast<int>(std::min(SAMPLE_BUCKETS, bucket_count) * TT_BUCKET_SIZE);
     }
 
-    TTEntry& get_entry(uint64_t hash) {
-        uint64_t index = get_index(hash);
-        return table[index];
+    size_t size_mb() const {
+        return bucket_count * sizeof(TTBucket) / (1024 * 1024);
     }
 
-    void add_entry(const TTEntry& entry) {
-        uint64_t index = get_index(entry.hash);
-        table[index] = entry;
+    PageMode page_mode() const {
+        return is_shared() ? shared.mode : memory.mode;
     }
 
-    // We verify that the stored position hash matches the current one to ensure
-    // the entry corresponds to the same position. This prevents hash collisions where
-    // two different positions share the same lower bits and map to the same table index.
-    bool is_valid_entry(uint64_t hash, const TTEntry& entry) {
-        return entry.node != NO_TT_ENTRY && hash == entry.hash;
+    // Starts loading the bucket of the given hash into the cache without waiting for it.
+    // Called before making a move so that the child's bucket arrives while the move
+    // is made and the child's moves are generated.
+    void prefetch(uint64_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(&table[get_index(hash)]);
+#elif defined(_MSC_VER)
+        _mm_prefetch(reinterpret_cast<const char*>(&table[get_index(hash)]), _MM_HINT_T0);
+#endif
+    }
+
+    // Looks up the position in its bucket and copies the entry if found
+    // Note that the best move may still be illegal due to key collisions, so it must be
+    // validated (see is_legal_move) before it is made
+    bool probe(uint64_t hash, TTEntry& entry) const {
+        const TTBucket& bucket = table[get_index(hash)];
+        uint16_t key = get_key(hash);
+
+        for (const auto& slot : bucket.entries) {
+            TTEntry candidate = load(slot);
+            if (candidate.key == key && candidate.node() != NO_TT_ENTRY) {
+                entry = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Returns true if a deeper entry of a different position had to be replaced
+    bool store(uint64_t hash, Move best_move, SearchDepth depth, PositionScore score, TTNode node) {
+        TTBucket& bucket = table[get_index(hash)];
+        uint16_t key = get_key(hash);
+
+        // Overwrite the entry for the same position if there is one. Otherwise, replace
+        // the entry with the lowest depth, preferring entries from older searches
+        // Other threads may write to the bucket in the meantime, in which case one of the
+        // writes is lost - this is harmless since entries are always written whole
+        int replace_index = 0;
+        TTEntry replace = load(bucket.entries[0]);
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+            TTEntry candidate = load(bucket.entries[i]);
+            if (candidate.key == key || candidate.node() == NO_TT_ENTRY) {
+                replace_index = i;
+                replace = candidate;
+                break;
+            }
+
+            if (replacement_value(candidate) < replacement_value(replace)) {
+                replace_index = i;
+                replace = candidate;
+            }
+        }
+
+        // Keep the old best move if we don't have one for this position
+        if (best_move == NULL_MOVE && replace.key == key) {
+            best_move = replace.best_move;
+        }
+
+        TTEntry entry;
+        entry.key = key;
+        entry.best_move = best_move;
+        entry.score = score;
+        entry.depth = depth;
+        entry.generation_node = (generation << TTEntry::TT_NODE_BITS) | node;
+        bucket.entries[replace_index].store(std::bit_cast<uint64_t>(entry), std::memory_order_relaxed);
+
+        return replace.key != key && replace.node() != NO_TT_ENTRY && replace.depth > depth;
     }
 
 private:
+    LargePageAllocation memory;
+    SharedMemoryMapping shared;
+    std::string shared_name;
+    TTBucket* table = nullptr;
+    uint64_t bucket_count = 0;
+    uint8_t generation = 0;
+
+    bool allocate(size_t mb);
+    bool attach_shared(const std::string& name, size_t mb);
+
+    // Frees the private table or detaches from the shared one
+    void release();
 
-    inline uint64_t get_index(uint64_t hash) {
-        return hash & (TRANSPOSITION_TABLE_SIZE - 1);
+    // Resizes the table to match a hash file and fills it using read(table, start, end)
+    template <typename ReadFn>
+    bool load_buckets(const TTFileHeader& header, int threads, ReadFn read);
+
+    // Number of searches since the entry was written (accounting for wrap around)
+    inline int age(const TTEntry& entry) const {
+        return (generation - entry.generation()) & TT_GENERATION_MASK;
     }
-};
 
-inline TranspositionTable TT;
\ No newline at end of file
+    // Deep entries are worth keeping, but old entries are likely no longer relevant
+    inline int replacement_value(const TTEntry& entry) const {
+        return entry.depth - TT_AGE_WEIGHT * age(entry);
+    }
+
+    static inline TTEntry load(const std::atomic<uint64_t>& slot) {
+        return std::bit_cast<TTEntry>(slot.load(std::memory_order_relaxed));
+    }
+
+    static inline uint16_t get_key(uint64_t hash) {
+        return static_cast<uint16_t>(hash);
+    }
+
+    // Maps the hash onto [0, bucket_count) by taking the upper 64 bits of hash * bucket_count.
+    // Unlike masking the lower bits, this works for table sizes that aren't powers of two.
+    inline uint64_t get_index(uint64_t hash) const {
+#if defined(__SIZEOF_INT128__)
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(hash) * bucket_count) >> 64);
+#elif defined(_MSC_VER)
+        return __umulh(hash, bucket_count);
+#else
+        // Portable fallback: compute the high half of the 128 bit product from 32 bit halves
+        uint64_t a_lo = hash & 0xFFFFFFFF, a_hi = hash >> 32;
+        uint64_t b_lo = bucket_count & 0xFFFFFFFF, b_hi = bucket_count >> 32;
+        uint64_t mid = (a_lo * b_lo >> 32) + (a_hi * b_lo & 0xFFFFFFFF) + a_lo * b_hi;
+        return a_hi * b_hi + (a_hi * b_lo >> 32) + (mid >> 32);
+#endif
+    }
+};
\ No newline at end of file
@@ -15,7 +15,6 @@
 #endif
 
 // --- Globals ---
-extern std::atomic<bool> stop_requested;
 inline std::filesystem::path FEN_DIR = std::filesystem::path(PROJECT_ROOT) / "fen";
 
 // --- FEN/EPD Files ---
@@ -39,15 +38,29 @@ constexpr int BOARD_SIZE     = 8;
 // Upper bound for the maximum depth (ply) we can search in a given position
 constexpr int MAX_PLY   = 256;
 
+// Upper bound for the depth of an iterative deepening iteration (leaves room in the
+// ply stacks for quiescence search and the moves leading up to the position)
+constexpr int MAX_DEPTH = 128;
+
 // Upper bound for the maximum number of moves we can generate at a given depth
 constexpr int MAX_MOVES = 256;
 
-constexpr uint64_t TRANSPOSITION_TABLE_SIZE = uint64_t{1} << 20;
+// Upper bound for the number of search threads (main thread + helpers)
+constexpr int MAX_THREADS = 1024;
+
+// Transposition table size in megabytes (configurable via the UCI Hash option)
+constexpr size_t DEFAULT_HASH_MB = 16;
+constexpr size_t MIN_HASH_MB     = 1;
+constexpr size_t MAX_HASH_MB     = size_t{1} << 20;
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t HUGE_PAGE_SIZE  = size_t{2} << 20;
 
 // --- Type Definitions ---
 
 using Bitboard          = uint64_t;
 using MoveScore         = uint32_t;
+using HistoryScore      = int16_t;
 using MoveType          = uint16_t;
 using MoveFlag          = uint16_t;
 using PositionScore     = int16_t;
@@ -61,20 +74,30 @@ using CastleType        = uint8_t;
 using MoveSelectorPhase = uint8_t;
 using SearchDepth       = uint8_t;
 using TTNode            = uint8_t;
+using PageMode          = uint8_t;
 using Direction         = int;
 using SearchMode        = int;
 using MoveGenMode       = int;
 
 // --- History Table Type Definitions ---
 
+// History scores are signed (moves that failed are penalized) and bounded by MAX_HISTORY
+constexpr int MAX_HISTORY = 16'384;
+
 // color_piece_to[color][piece][to]
-using ColorPieceToHistory = std::array<std::array<std::array<MoveScore, NUM_SQUARES>, NUM_PIECES>, NUM_COLORS>;
+using ColorPieceToHistory = std::array<std::array<std::array<HistoryScore, NUM_SQUARES>, NUM_PIECES>, NUM_COLORS>;
 
 // from_to[from][to]
-using FromToHistory = std::array<std::array<MoveScore, NUM_SQUARES>, NUM_SQUARES>;
+using FromToHistory = std::array<std::array<HistoryScore, NUM_SQUARES>, NUM_SQUARES>;
+
+// continuation_history[prev color][prev piece][prev to][color][piece][to], where prev is
+// a move made one or two plies before the move being scored
+using ContinuationHistory = std::array<std::array<std::array<ColorPieceToHistory, NUM_SQUARES>, NUM_PIECES>, NUM_COLORS>;
 
 // --- Scores ---
-constexpr PositionScore MAX_SCORE          =  30'000;
+// MAX_SCORE/MIN_SCORE bound every real score (including checkmates) so they can be used
+// as an infinite search window
+constexpr PositionScore MAX_SCORE          =  32'500;
 constexpr PositionScore MIN_SCORE          = -MAX_SCORE;
 constexpr PositionScore CHECKMATE_SCORE    =  32'000;
 constexpr PositionScore STALEMATE_SCORE    =  0;
@@ -192,7 +215,8 @@ enum MoveSelectorPhaseEnum : MoveSelectorPhase {
     GOOD_CAPTURE,
     KILLER,
     QUIET_MOVE,
-    BAD_CAPTURE
+    BAD_CAPTURE,
+    NO_MOVES_LEFT
 };
 
 enum MoveGenModeEnum : MoveGenMode {
@@ -201,11 +225,18 @@ enum MoveGenModeEnum : MoveGenMode {
     CAPTURES_AND_PROMOTIONS
 };
 
+// NO_TT_ENTRY is 0 so that a zeroed table is an empty table
 enum TTNodeEnum : TTNode {
+    NO_TT_ENTRY,
     EXACT,
     FAIL_HIGH,
-    FAIL_LOW,
-    NO_TT_ENTRY
+    FAIL_LOW
+};
+
+enum PageModeEnum : PageMode {
+    HUGETLB_PAGES,          // Explicitly reserved huge pages (hugetlbfs)
+    TRANSPARENT_HUGE_PAGES, // Regular allocation promoted to huge pages by the kernel
+    REGULAR_PAGES
 };
 
 // Ranks and Files
@@ -9,13 +9,25 @@
 //    the engine's best move against known best moves. Each position is searched for a fixed
 //    time, and results show the percentage of positions where the engine found the best move.
 //
-// Usage: ./build/enigma bench [--fast] [--verbose] [--phased] [--movegen] [--engine]
+// 3. TT BENCH: Searches the engine bench positions for a fixed number of nodes (so the results
+//    are reproducible) and prints how the transposition table was used for each position.
+//    Useful for sizing the hash and catching regressions in the replacement policy.
+//
+// 4. SEARCH BENCH: Searches the engine bench positions to a fixed depth with one thread and
+//    reports the nodes searched for each position. The node count is deterministic, so it
+//    shows exactly how much a change to pruning, reductions or move ordering shrinks the tree.
+//
+// Usage: ./build/enigma bench [--fast] [--verbose] [--phased] [--movegen] [--engine] [--tt] [--search]
+// Without section flags, only the movegen and engine benches run. The TT and search benches
+// are opt-in.
 
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 #include <cstdint>
 #include <chrono>
 #include <iomanip>
+#include <sstream>
 
 #include "types.hpp"
 #include "bench.hpp"
@@ -28,6 +40,8 @@ const int NUM_MOVEGEN_POSITIONS_FAST = 1000;
 const int NUM_ENGINE_POSITIONS_FAST = 10;
 const int ENGINE_SEARCH_TIME_MS = 10000;
 const int MAX_FAILURES_TO_DISPLAY = 10;
+const uint64_t TT_BENCH_SEARCH_NODES = 1000000;
+const SearchDepth SEARCH_BENCH_DEPTH = 6;
 
 static inline std::vector<std::string> collect_lines(bool fast) {
     std::vector<std::string> buffer;
@@ -81,6 +95,7 @@ MovegenBenchResult run_movegen_bench(bool verbose, bool fast, bool phased) {
 EngineBenchResult run_engine_bench(bool verbose, bool fast) {
     std::clog << "Running engine bench...\n";
     Board b;
+    Searcher searcher;
 
     // Read engine benchmark file
     std::vector<std::string> lines;
@@ -113,7 +128,7 @@ EngineBenchResult run_engine_bench(bool verbose, bool fast) {
         }
 
         // Search the position
-        Move best_move = search_time(b, ENGINE_SEARCH_TIME_MS);
+        Move best_move = searcher.search_time(b, ENGINE_SEARCH_TIME_MS);
         positions_tested++;
 
         // Compare moves
@@ -142,12 +157,120 @@ EngineBenchResult run_engine_bench(bool verbose, bool fast) {
     return {success, positions_tested, positions_correct, failures};
 }
 
+// Percentage of part in total, formatted with one decimal
+static inline std::string percent(uint64_t part, uint64_t total) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << (total == 0 ? 0.0 : 100.0 * part / total) << "%";
+    return oss.str();
+}
+
+TTBenchResult run_tt_bench(bool fast) {
+    std::clog << "Running TT bench...\n";
+    Board b;
+    Searcher searcher;
+
+    std::vector<std::string> lines;
+    read_file(lines, ENGINE_EPD, fast ? NUM_ENGINE_POSITIONS_FAST : -1);
+
+    TTBenchResult result = {};
+    uint64_t total_hashfull = 0;
+
+    std::clog << "\n" << std::left
+              << std::setw(6) << "#" << std::setw(12) << "Probes" << std::setw(9) << "Hits"
+              << std::setw(11) << "Cutoffs" << std::setw(15) << "Deeper overw." << std::setw(12) << "Mismatches"
+              << "Hashfull\n";
+
+    for (const auto& line : lines) {
+        auto epd = parse_engine_epd_line(line);
+        if (epd.fen.empty()) continue;
+
+        // Start every position from empty tables so that the numbers don't depend on
+        // the positions before it
+        b.reset();
+        b.load_from_fen(epd.fen);
+        searcher.clear_hash();
+        searcher.clear_history();
+
+        // Silence the search's info lines
+        std::streambuf* cout_buffer = std::cout.rdbuf(nullptr);
+        searcher.search_nodes(b, TT_BENCH_SEARCH_NODES);
+        std::cout.rdbuf(cout_buffer);
+
+        TTStats stats = searcher.tt_stats();
+        int hashfull = searcher.hashfull();
+
+        result.positions_tested++;
+        result.total_nodes += TT_BENCH_SEARCH_NODES;
+        result.stats += stats;
+        total_hashfull += hashfull;
+
+        std::clog << std::setw(6) << result.positions_tested << std::setw(12) << stats.probes
+                  << std::setw(9) << percent(stats.hits, stats.probes)
+                  << std::setw(11) << percent(stats.cutoffs, stats.probes)
+                  << std::setw(15) << stats.deeper_overwrites << std::setw(12) << stats.move_mismatches
+                  << hashfull << "\n";
+    }
+    std::clog << std::right;
+
+    result.average_hashfull = result.positions_tested == 0 ? 0 : total_hashfull / result.positions_tested;
+    return result;
+}
+
+SearchBenchResult run_search_bench(bool fast) {
+    std::clog << "Running search bench...\n";
+    Board b;
+    Searcher searcher;
+
+    std::vector<std::string> lines;
+    read_file(lines, ENGINE_EPD, fast ? NUM_ENGINE_POSITIONS_FAST : -1);
+
+    SearchBenchResult result = {};
+
+    std::clog << "\n" << std::left << std::setw(6) << "#" << std::setw(14) << "Nodes" << "Time (ms)\n";
+
+    for (const auto& line : lines) {
+        auto epd = parse_engine_epd_line(line);
+        if (epd.fen.empty()) continue;
+
+        // Start every position from empty tables so that the node counts are reproducible
+        b.reset();
+        b.load_from_fen(epd.fen);
+        searcher.clear_hash();
+        searcher.clear_history();
+
+        // Silence the search's info lines
+        std::streambuf* cout_buffer = std::cout.rdbuf(nullptr);
+        auto start = std::chrono::steady_clock::now();
+        searcher.search_depth(b, SEARCH_BENCH_DEPTH);
+        auto end = std::chrono::steady_clock::now();
+        std::cout.rdbuf(cout_buffer);
+
+        uint64_t nodes = searcher.nodes();
+        double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        result.positions_tested++;
+        result.total_nodes += nodes;
+        result.total_seconds += seconds;
+
+        std::clog << std::setw(6) << result.positions_tested << std::setw(14) << nodes
+                  << static_cast<uint64_t>(seconds * 1000) << "\n";
+    }
+    std::clog << std::right;
+
+    return result;
+}
+
 BenchResults run_bench(const BenchFlags& flags) {
     BenchResults results = {};
 
     // Determine what to run
-    bool run_movegen = !flags.engine_only;
-    bool run_engine = !flags.movegen_only;
+    // Movegen and engine run unless specific sections were asked for
+    // The TT and search sections are slow, so they only run when asked for (--tt / --search)
+    bool run_default = !flags.movegen_only && !flags.engine_only && !flags.tt_only && !flags.search_only;
+    bool run_movegen = run_default || flags.movegen_only;
+    bool run_engine = run_default || flags.engine_only;
+    bool run_tt = flags.tt_only;
+    bool run_search = flags.search_only;
 
     // Run movegen bench
     if (run_movegen) {
@@ -161,6 +284,18 @@ BenchResults run_bench(const BenchFlags& flags) {
         results.ran_engine = true;
     }
 
+    // Run TT bench
+    if (run_tt) {
+        results.tt = run_tt_bench(flags.fast);
+        results.ran_tt = true;
+    }
+
+    // Run search bench
+    if (run_search) {
+        results.search = run_search_bench(flags.fast);
+        results.ran_search = true;
+    }
+
     // Output final results
     std::clog << "\n========== BENCH RESULTS ==========\n";
 
@@ -203,6 +338,28 @@ BenchResults run_bench(const BenchFlags& flags) {
         }
     }
 
+    if (results.ran_tt) {
+        const TTStats& stats = results.tt.stats;
+        std::clog << "\n[TT BENCH]\n";
+        std::clog << "  Positions tested: " << results.tt.positions_tested << "\n";
+        std::clog << "  Nodes per search: " << TT_BENCH_SEARCH_NODES << "\n";
+        std::clog << "  Probes: " << stats.probes << "\n";
+        std::clog << "  Hits: " << stats.hits << " (" << percent(stats.hits, stats.probes) << ")\n";
+        std::clog << "  Cutoffs: " << stats.cutoffs << " (" << percent(stats.cutoffs, stats.probes) << ")\n";
+        std::clog << "  Deeper entries overwritten: " << stats.deeper_overwrites << "\n";
+        std::clog << "  Move mismatches: " << stats.move_mismatches << "\n";
+        std::clog << "  Average hashfull: " << results.tt.average_hashfull << "\n";
+    }
+
+    if (results.ran_search) {
+        std::clog << "\n[SEARCH BENCH]\n";
+        std::clog << "  Positions tested: " << results.search.positions_tested << "\n";
+        std::clog << "  Depth: " << static_cast<int>(SEARCH_BENCH_DEPTH) << "\n";
+        std::clog << "  Total nodes: " << results.search.total_nodes << "\n";
+        std::clog << "  Time: " << std::fixed << std::setprecision(1) << results.search.total_seconds << " seconds\n";
+        std::clog << "  Nodes/sec: " << static_cast<uint64_t>(results.search.total_nodes / std::max(results.search.total_seconds, 0.001)) << "\n";
+    }
+
     std::clog << "===================================\n";
 
     return results;
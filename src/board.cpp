@@ -31,9 +31,6 @@ void Board::reset() {
     fullmoves = 0;
     ply = 0;
     zobrist_hash = 0;
-
-    // Reset transposition table
-    TT.clear();
 }
 
 void Board::load_from_fen(const std::string& fen) {
@@ -56,8 +53,9 @@ void Board::load_from_fen(const std::string& fen) {
     std::string to_move             = parts.size() > 1 ? parts[1] : "w";
     std::string castling_rights     = parts.size() > 2 ? parts[2] : "-";
     std::string en_passant_target   = parts.size() > 3 ? parts[3] : "-";
-    std::string halfmoves           = parts.size() > 4 ? parts[4] : "0";
-    std::string fullmoves           = parts.size() > 5 ? parts[5] : "1";
+    // EPD lines often leave out the move counters (or replace them with "-")
+    std::string halfmoves           = parts.size() > 4 && is_pos_int(parts[4]) ? parts[4] : "0";
+    std::string fullmoves           = parts.size() > 5 && is_pos_int(parts[5]) ? parts[5] : "1";
 
     // Set up position starting from top left
     int rank = 7;
@@ -337,6 +335,81 @@ void Board::make_move(Move move) {
     ply += 1;
 }
 
+// Passes the turn to the opponent without moving a piece (used by null move pruning)
+// The null move is pushed onto the stacks like any other move (as NULL_MOVE) so that
+// the previous move is always at moves[ply - 1] and the state can be restored
+void Board::make_null_move() {
+    moves[ply] = NULL_MOVE;
+    states[ply] = State(en_passant_target, castling_rights, halfmoves, NO_PIECE);
+    ply += 1;
+
+    // The opponent can't capture en passant after a null move
+    xor_en_passant();
+    en_passant_target = NO_SQUARE;
+
+    halfmoves++;
+    if (to_move == BLACK) fullmoves++;
+
+    to_move ^= 1;
+    xor_side_to_move();
+}
+
+void Board::unmake_null_move() {
+    ply -= 1;
+
+    to_move ^= 1;
+    xor_side_to_move();
+
+    if (to_move == BLACK) fullmoves--;
+
+    const State& prev_state = states[ply];
+    en_passant_target = prev_state.en_passant_target;
+    halfmoves = prev_state.halfmoves;
+    xor_en_passant();
+}
+
+// Computes the hash of the position after the move without making it. This is used to
+// prefetch the transposition table bucket of the child position before making the move.
+// The rook move of a castle and the captured pawn of an en passant are ignored since
+// those moves are rare, so the key is only a (very good) approximation for them.
+uint64_t Board::key_after(Move move) const {
+    Square from = move.from();
+    Square to = move.to();
+    Piece moving_piece = piece_map[from];
+    Piece captured_piece = piece_map[to];
+    Color us = to_move;
+
+    uint64_t key = zobrist_hash ^ ZOBRIST_SIDE_TO_MOVE;
+
+    // Move the piece (promotions place a different piece on the "to" square)
+    Piece placed_piece = moving_piece;
+    switch (move.flag()) {
+        case PROMOTION_BISHOP: placed_piece = BISHOP; break;
+        case PROMOTION_KNIGHT: placed_piece = KNIGHT; break;
+        case PROMOTION_ROOK:   placed_piece = ROOK;   break;
+        case PROMOTION_QUEEN:  placed_piece = QUEEN;  break;
+    }
+    key ^= ZOBRIST_PIECES[us][moving_piece][from] ^ ZOBRIST_PIECES[us][placed_piece][to];
+
+    if (captured_piece != NO_PIECE) {
+        key ^= ZOBRIST_PIECES[us ^ 1][captured_piece][to];
+    }
+
+    // The previous en passant target is always cleared and a double pawn push sets a new one
+    if (en_passant_target != NO_SQUARE) {
+        key ^= ZOBRIST_EN_PASSANT_TARGETS[get_file(en_passant_target)];
+    }
+    if (moving_piece == PAWN && (from ^ to) == 16) {
+        key ^= ZOBRIST_EN_PASSANT_TARGETS[get_file(to)];
+    }
+
+    // Castling rights may be lost by moving from or to a rook/king square
+    CastlingRights new_castling_rights = castling_rights & ~castling_rights_updates[from] & ~castling_rights_updates[to];
+    key ^= ZOBRIST_CASTLING_RIGHTS[castling_rights] ^ ZOBRIST_CASTLING_RIGHTS[new_castling_rights];
+
+    return key;
+}
+
 void Board::unmake_move(Move move) {
     Square from     = move.from();
     Square to       = move.to();
@@ -428,29 +501,31 @@ void Board::unmake_move(Move move) {
     xor_side_to_move();
 }
 
-// Used to determine if the side to move is in check
-bool Board::in_check() const {
-    // This function uses piece attacks masks to determine if the side to move's
-    // king is in check. For non-sliding pieces, we can use precomputed attack maps
-    // and for sliding pieces we can generate attack masks.
+// Used to determine if a square is attacked by any piece of the given color
+bool Board::is_square_attacked(Square square, Color by) const {
+    // This function uses piece attacks masks to determine if the square is attacked.
+    // For non-sliding pieces, we can use precomputed attack maps and for sliding pieces
+    // we can generate attack masks from the square.
     // These masks are intersected with their respective enemy piece bitboards. 
-    // If there is an intersection (i.e. result is not 0), then the king is attacked
+    // If there is an intersection (i.e. result is not 0), then the square is attacked
     // by the piece. We collect all intersections using a union (faster than branching)
     // and return the result which should be implicitly cast to a boolean.
 
-    Bitboard check_mask = 0;
-    Square king_sq = king_squares[to_move];
-    Color them = to_move ^ 1;
-    auto& enemy_pieces = pieces[them];
+    auto& enemy_pieces = pieces[by];
 
     return (
         // Non-sliding pieces
-        (KNIGHT_ATTACK_MAP[king_sq] & enemy_pieces[KNIGHT]) |
-        (KING_ATTACK_MAP[king_sq] & enemy_pieces[KING]) |
-        (PAWN_ATTACK_MAPS[them][king_sq] & enemy_pieces[PAWN]) |
+        (KNIGHT_ATTACK_MAP[square] & enemy_pieces[KNIGHT]) |
+        (KING_ATTACK_MAP[square] & enemy_pieces[KING]) |
+        (PAWN_ATTACK_MAPS[by][square] & enemy_pieces[PAWN]) |
 
         // Sliding pieces
-        (generate_sliding_attack_mask<ROOK>(*this, king_sq) & (enemy_pieces[ROOK] | enemy_pieces[QUEEN])) |
-        (generate_sliding_attack_mask<BISHOP>(*this, king_sq) & (enemy_pieces[BISHOP] | enemy_pieces[QUEEN]))
+        (generate_sliding_attack_mask<ROOK>(*this, square) & (enemy_pieces[ROOK] | enemy_pieces[QUEEN])) |
+        (generate_sliding_attack_mask<BISHOP>(*this, square) & (enemy_pieces[BISHOP] | enemy_pieces[QUEEN]))
     );
+}
+
+// Used to determine if the side to move is in check
+bool Board::in_check() const {
+    return is_square_attacked(king_squares[to_move], to_move ^ 1);
 }
\ No newline at end of file
@@ -21,13 +21,14 @@ int main(int argc, char* argv[]) {
     // ### MAIN UCI LOOP
     if (args.size() == 0) {
         uci_loop();
+        return EXIT_SUCCESS;
     }
 
     std::string cmd = args[0];
 
     // ### BENCH - Comprehensive move generation test suite
     if (cmd == "bench") {
-        BenchFlags flags = {false, false, false, false, false};
+        BenchFlags flags = {false, false, false, false, false, false, false};
 
         for (int i = 1; i < args.size(); i++) {
             if (args[i] == "--verbose"){
@@ -40,6 +41,10 @@ int main(int argc, char* argv[]) {
                 flags.movegen_only = true;
             } else if (args[i] == "--engine") {
                 flags.engine_only = true;
+            } else if (args[i] == "--tt") {
+                flags.tt_only = true;
+            } else if (args[i] == "--search") {
+                flags.search_only = true;
             } else {
                 std::clog << "Error: Unknown option for bench '" << args[i] << "'\n";
                 return EXIT_FAILURE;
@@ -82,7 +87,8 @@ int main(int argc, char* argv[]) {
         if (cmd == "perft") {
             perft<true>(b, depth);
         } else {
-            Move best_move = search_depth(b, depth);
+            Searcher searcher;
+            Move best_move = searcher.search_depth(b, depth);
             std::cout << "Best move: " << decode_move_to_uci(best_move) << "\n";
         }
     } 
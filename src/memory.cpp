@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "memory.hpp"
+
+void* allocate_aligned(size_t alignment, size_t size) {
+    // Both std::aligned_alloc and _aligned_malloc require size to be a multiple of alignment
+    size = (size + alignment - 1) & ~(alignment - 1);
+
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void free_aligned(void* ptr) {
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+#if defined(__linux__)
+// madvise(MADV_HUGEPAGE) succeeds even if transparent huge pages are turned off, so we
+// check the system setting to report the page mode accurately
+// Anonymous memory and shared memory have separate settings
+static const char* THP_SETTING = "/sys/kernel/mm/transparent_hugepage/enabled";
+static const char* THP_SHMEM_SETTING = "/sys/kernel/mm/transparent_hugepage/shmem_enabled";
+
+static bool transparent_huge_pages_enabled(const char* setting_path) {
+    std::ifstream file(setting_path);
+    std::string setting;
+    std::getline(file, setting);
+    return file && setting.find("[never]") == std::string::npos && setting.find("[deny]") == std::string::npos;
+}
+#endif
+
+LargePageAllocation allocate_large_pages(size_t size) {
+    LargePageAllocation allocation;
+
+    // Round up to a whole number of huge pages
+    allocation.size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+#if defined(__linux__)
+    // Reserved huge pages are guaranteed to be huge, but most systems don't reserve any
+    void* ptr = mmap(
+        nullptr, allocation.size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0
+    );
+    if (ptr != MAP_FAILED) {
+        allocation.ptr = ptr;
+        allocation.mode = HUGETLB_PAGES;
+        return allocation;
+    }
+
+    // Otherwise, ask the kernel to back a huge page aligned block with transparent huge pages
+    allocation.ptr = allocate_aligned(HUGE_PAGE_SIZE, allocation.size);
+    if (
+        allocation.ptr != nullptr
+        && madvise(allocation.ptr, allocation.size, MADV_HUGEPAGE) == 0
+        && transparent_huge_pages_enabled(THP_SETTING)
+    ) {
+        allocation.mode = TRANSPARENT_HUGE_PAGES;
+    }
+#else
+    allocation.ptr = allocate_aligned(CACHE_LINE_SIZE, allocation.size);
+#endif
+
+    return allocation;
+}
+
+void free_large_pages(LargePageAllocation& allocation) {
+#if defined(__linux__)
+    if (allocation.mode == HUGETLB_PAGES) {
+        munmap(allocation.ptr, allocation.size);
+        allocation = {};
+        return;
+    }
+#endif
+
+    free_aligned(allocation.ptr);
+    allocation = {};
+}
+
+SharedMemoryMapping map_shared_memory(const std::string& name, size_t size) {
+    SharedMemoryMapping mapping;
+
+#if defined(__linux__)
+    // Only one process gets to create (and size) the segment, the others open it as is
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) {
+        if (ftruncate(fd, size) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            return mapping;
+        }
+        mapping.created = true;
+    } else {
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd == -1) return mapping;
+    }
+
+    // Give the process that created the segment a moment to size it
+    struct stat st;
+    bool sized = fstat(fd, &st) == 0 && st.st_size != 0;
+    for (int i = 0; i < 1000 && !sized && !mapping.created; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        sized = fstat(fd, &st) == 0 && st.st_size != 0;
+    }
+
+    if (!sized) {
+        close(fd);
+        return mapping;
+    }
+
+    mapping.size = st.st_size;
+    void* ptr = mmap(nullptr, mapping.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        mapping = {};
+        return mapping;
+    }
+    mapping.ptr = ptr;
+
+    if (
+        madvise(mapping.ptr, mapping.size, MADV_HUGEPAGE) == 0
+        && transparent_huge_pages_enabled(THP_SHMEM_SETTING)
+    ) {
+        mapping.mode = TRANSPARENT_HUGE_PAGES;
+    }
+#endif
+
+    return mapping;
+}
+
+void unmap_shared_memory(SharedMemoryMapping& mapping) {
+#if defined(__linux__)
+    if (mapping.ptr != nullptr) {
+        munmap(mapping.ptr, mapping.size);
+    }
+#endif
+
+    mapping = {};
+}
+
+bool remove_shared_memory(const std::string& name) {
+#if defined(__linux__)
+    return shm_unlink(name.c_str()) == 0;
+#else
+    return false;
+#endif
+}
+
+const char* page_mode_name(PageMode mode) {
+    switch (mode) {
+        case HUGETLB_PAGES:          return "huge pages (hugetlbfs)";
+        case TRANSPARENT_HUGE_PAGES: return "transparent huge pages";
+        default:                     return "regular pages";
+    }
+}
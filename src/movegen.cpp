@@ -291,6 +291,123 @@ MoveList generate_moves(Board &b) {
     return moves;
 }
 
+// Checks the castling move against castling rights, the castle path and attacked squares
+static inline bool is_legal_castle(const Board& b, Move move) {
+    Color us = b.to_move;
+    Color them = us ^ 1;
+    Square to = move.to();
+
+    CastlingRights rights;
+    Bitboard path;
+    Square king_from, king_path_from, king_path_to;
+    switch (to) {
+        case G1: rights = WHITE_SHORT; path = WHITE_SHORT_CASTLE_PATH; king_from = E1; king_path_from = F1; king_path_to = G1; break;
+        case C1: rights = WHITE_LONG;  path = WHITE_LONG_CASTLE_PATH;  king_from = E1; king_path_from = D1; king_path_to = C1; break;
+        case G8: rights = BLACK_SHORT; path = BLACK_SHORT_CASTLE_PATH; king_from = E8; king_path_from = F8; king_path_to = G8; break;
+        case C8: rights = BLACK_LONG;  path = BLACK_LONG_CASTLE_PATH;  king_from = E8; king_path_from = D8; king_path_to = C8; break;
+        default: return false;
+    }
+
+    // Castling rights are per color, so this also checks that the castle belongs to us
+    CastlingRights our_rights = us == WHITE ? (WHITE_SHORT | WHITE_LONG) : (BLACK_SHORT | BLACK_LONG);
+
+    return (
+        move.type() == QUIET
+        && move.from() == king_from
+        && (rights & our_rights)
+        && (b.castling_rights & rights)
+        && (b.occupied & path) == 0
+        && !b.is_square_attacked(king_from, them)
+        && !b.is_square_attacked(king_path_from, them)
+        && !b.is_square_attacked(king_path_to, them)
+    );
+}
+
+// Checks that the move follows the movement rules of the piece on the "from" square
+// (ignoring whether it leaves our king in check)
+static inline bool is_pseudo_legal_move(const Board& b, Move move) {
+    Color us = b.to_move;
+    Color them = us ^ 1;
+    Square from = move.from();
+    Square to = move.to();
+    MoveFlag flag = move.flag();
+    Piece piece = b.piece_map[from];
+    Bitboard to_mask = get_mask(to);
+
+    // We must move one of our own pieces and can't capture our own pieces
+    if (flag > PROMOTION_QUEEN || piece == NO_PIECE || !(b.colors[us] & get_mask(from)) || (b.colors[us] & to_mask)) {
+        return false;
+    }
+
+    if (flag == CASTLE) {
+        return piece == KING && is_legal_castle(b, move);
+    }
+
+    // Other than en passant, the move type has to match the occupancy of the "to" square
+    if (flag != EN_PASSANT && (move.type() == CAPTURE) != ((b.colors[them] & to_mask) != 0)) {
+        return false;
+    }
+
+    if (piece != PAWN) {
+        if (flag != NORMAL) return false;
+
+        Bitboard attack_mask =
+            piece == KING   ? KING_ATTACK_MAP[from]                       :
+            piece == KNIGHT ? KNIGHT_ATTACK_MAP[from]                     :
+            piece == BISHOP ? generate_sliding_attack_mask<BISHOP>(b, from) :
+            piece == ROOK   ? generate_sliding_attack_mask<ROOK>  (b, from) :
+                              generate_sliding_attack_mask<BISHOP>(b, from) |
+                              generate_sliding_attack_mask<ROOK>  (b, from);
+
+        return (attack_mask & to_mask) != 0;
+    }
+
+    // Pawn moves
+    Direction forward = us == WHITE ? NORTH : SOUTH;
+    Rank promotion_rank = us == WHITE ? RANK_8 : RANK_1;
+    Rank double_push_rank = us == WHITE ? RANK_4 : RANK_5;
+
+    // A pawn move is a promotion if and only if it reaches the last rank
+    if (move.is_promotion() != (get_rank(to) == promotion_rank)) {
+        return false;
+    }
+
+    // PAWN_ATTACK_MAPS[us][to] contains the squares from which our pawns attack "to"
+    bool attacks_to = (PAWN_ATTACK_MAPS[us][to] & get_mask(from)) != 0;
+
+    if (flag == EN_PASSANT) {
+        return move.type() == CAPTURE && to == b.en_passant_target && attacks_to;
+    }
+
+    if (move.type() == CAPTURE) {
+        return attacks_to;
+    }
+
+    // Quiet pawn pushes must land on empty squares
+    if (b.occupied & to_mask) return false;
+    if (to == from + forward) return true;
+
+    return (
+        to == from + 2 * forward
+        && get_rank(to) == double_push_rank
+        && !(b.occupied & get_mask(from + forward))
+    );
+}
+
+bool is_legal_move(Board& b, Move move) {
+    if (move == NULL_MOVE || !is_pseudo_legal_move(b, move)) {
+        return false;
+    }
+
+    // Make the move to check if it leaves our king in check
+    Color us = b.to_move;
+    b.make_move(move);
+    bool is_legal = !b.is_square_attacked(b.king_squares[us], us ^ 1);
+    b.unmake_move(move);
+
+    return is_legal;
+}
+
 // Explicit template instantiations
 template MoveList generate_moves<ALL>(Board&);
 template MoveList generate_moves<QUIET_ONLY>(Board&);
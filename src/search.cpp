@@ -1,6 +1,12 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "types.hpp"
 #include "search.hpp"
@@ -8,17 +14,13 @@
 #include "move_generator.hpp"
 #include "evaluate.hpp"
 #include "transposition_table.hpp"
+#include "move_selector.hpp"
+#include "see.hpp"
 
 /*
 Search
-5. Killer moves
-6. Principal variation search + aspiration windows
-7. Enhanced move ordering/move selector (MVV-LVA, history heuristic, phases, SEE)
 8. stackalloc instead of regular array in movelist to speed up movegen?
-9. null move pruning
-10. late move reductions
 11. opening book/endgame tablebase
-12. internal iterative deepening when no TT move
 
 Evaluation
 1. piece square tables
@@ -34,27 +36,266 @@ Evaluation
 7. bishop pairs
 */
 
-static SearchState ss;
-
 constexpr uint64_t TIME_CHECK_PERIOD_MASK = 2047;
 
+// Aspiration windows: iterations from this depth onwards start with a window of
+// +/- ASPIRATION_WINDOW around the previous score, which doubles on every fail
+constexpr SearchDepth ASPIRATION_MIN_DEPTH = 4;
+constexpr PositionScore ASPIRATION_WINDOW = 25;
+
+// Null move pruning: the reduction grows with depth and with how far the static eval
+// is above beta
+constexpr int NMP_MIN_DEPTH = 3;
+constexpr int NMP_BASE_REDUCTION = 3;
+constexpr int NMP_DEPTH_DIVISOR = 4;
+constexpr int NMP_EVAL_DIVISOR = 200;
+constexpr int NMP_MAX_EVAL_REDUCTION = 3;
+
+// From this depth onwards, null move cutoffs are verified by a search without null moves
+constexpr int NMP_VERIFICATION_DEPTH = 12;
+
+// Reverse futility pruning: at shallow depth, cut nodes whose static eval beats beta by
+// a margin per ply of remaining depth
+constexpr int RFP_MAX_DEPTH = 6;
+constexpr int RFP_MARGIN = 80;
+
+// Razoring: at shallow depth, nodes whose static eval is far below alpha are checked with a
+// quiescence search, which decides the node if it confirms the fail low
+constexpr int RAZOR_MAX_DEPTH = 3;
+constexpr int RAZOR_MARGIN = 200;
+
+// Futility pruning: at shallow depth, skip quiet moves if even the static eval plus a
+// margin can't raise alpha
+constexpr int FP_MAX_DEPTH = 5;
+constexpr int FP_BASE_MARGIN = 100;
+constexpr int FP_MARGIN = 80;
+
+// Late move pruning: at shallow depth, skip quiet moves after this many moves have been
+// searched (LMP_BASE + depth^2, halved when the static eval isn't improving)
+constexpr int LMP_MAX_DEPTH = 8;
+constexpr int LMP_BASE = 3;
+
+// Late move reductions: quiet moves late in the move order are searched with a reduced
+// depth, by LMR_BASE + ln(depth) * ln(move number) / LMR_DIVISOR plies
+constexpr int LMR_MIN_DEPTH = 3;
+constexpr int LMR_MIN_MOVES = 3; // Moves searched before we start reducing (one more in PV nodes)
+constexpr double LMR_BASE = 0.75;
+constexpr double LMR_DIVISOR = 2.25;
+constexpr int LMR_HISTORY_DIVISOR = 16384; // History score worth one ply less of reduction
+
+// Delta pruning: in quiescence search, captures that can't raise the static eval above alpha
+// even with this margin on top of the captured material are skipped
+constexpr int DELTA_MARGIN = 200;
+
+// Internal iterative reductions: from this depth onwards, PV and cut nodes without a hash
+// move are searched one ply shallower
+constexpr int IIR_MIN_DEPTH = 4;
+
+// Singular extensions: from this depth onwards, a hash move whose lower bound is at most
+// SE_TT_DEPTH_MARGIN plies shallower than the node is checked for being the only good move,
+// by searching the other moves with (depth - 1) / 2 plies against a bound SE_MARGIN per ply
+// below the hash score
+constexpr int SE_MIN_DEPTH = 8;
+constexpr int SE_TT_DEPTH_MARGIN = 3;
+constexpr int SE_MARGIN = 2;
+
+// History bonus for a quiet move that caused a beta cutoff (and the penalty for the quiet
+// moves searched before it), growing with the depth of the node
+constexpr int HISTORY_BONUS_MULTIPLIER = 32;
+constexpr int HISTORY_MAX_BONUS = 1536;
+
+// std::log isn't constexpr (until C++26), so the reduction table is computed with a series
+// ln(x) = k * ln(2) + ln(m) where x = m * 2^k and m is in [1, 2), and
+// ln(m) = 2 * atanh((m - 1) / (m + 1)), which converges quickly for m in [1, 2)
+constexpr double constexpr_log(double x) {
+    constexpr double LN_2 = 0.6931471805599453;
+
+    int k = 0;
+    while (x >= 2) {
+        x /= 2;
+        k++;
+    }
+
+    double y = (x - 1) / (x + 1);
+    double term = y;
+    double sum = 0;
+    for (int i = 1; i < 40; i += 2) {
+        sum += term / i;
+        term *= y * y;
+    }
+
+    return k * LN_2 + 2 * sum;
+}
+
+// LMR_REDUCTIONS[depth][move number]
+constexpr auto LMR_REDUCTIONS = []() {
+    std::array<std::array<uint8_t, MAX_MOVES>, MAX_DEPTH + 1> reductions{};
+    for (int depth = 1; depth <= MAX_DEPTH; depth++) {
+        for (int move_number = 1; move_number < MAX_MOVES; move_number++) {
+            reductions[depth][move_number] = static_cast<uint8_t>(
+                LMR_BASE + constexpr_log(depth) * constexpr_log(move_number) / LMR_DIVISOR
+            );
+        }
+    }
+    return reductions;
+}();
+
+// Each thread searches its own copy of the board with its own SearchState (killers,
+// history and node counter). The only thing that is shared between threads is the
+// transposition table, which is how the threads help each other (Lazy SMP).
+struct SearchWorker {
+    Searcher& searcher;
+    TranspositionTable& tt;
+    Board b;
+    SearchState ss;
+    int id;
+
+    // Depth of the current iteration, which bounds how far extensions can take the search
+    SearchDepth root_depth = 0;
+
+    // Nodes of the last root search and how many of them were spent on the best move
+    uint64_t root_nodes = 0;
+    uint64_t best_move_nodes = 0;
+
+    // Results of the last completed iteration
+    SearchDepth completed_depth = 0;
+    Move best_move;
+    PositionScore best_score = DUMMY_SCORE;
+    PrincipalVariation pv;
+
+    // Set while verifying a null move cutoff, which disables null moves in that subtree
+    bool verifying_null_move = false;
+
+    // Workers are kept between searches so that their history tables carry over
+    SearchWorker(Searcher& searcher, int id) : searcher(searcher), tt(searcher.tt), id(id) {}
+
+    // Resets everything but the history tables (which are aged) for a search from board
+    void new_search(const Board& board) {
+        b = board;
+        ss.limits = searcher.limits;
+        ss.root_ply = b.ply;
+        ss.search_interrupted = false;
+        ss.nodes = 0;
+        ss.stack = {};
+        ss.tt_stats = {};
+        ss.age_history();
+
+        root_depth = 0;
+        completed_depth = 0;
+        best_move = NULL_MOVE;
+        best_score = DUMMY_SCORE;
+        pv.length = 0;
+        verifying_null_move = false;
+    }
+
+    bool is_main() const { return id == 0; }
+
+    // Distance from the root of the search
+    int search_ply() const { return b.ply - ss.root_ply; }
+
+    template <SearchMode SM>
+    void iterative_deepening();
+
+private:
+    template <SearchMode SM>
+    inline bool should_stop_search();
+
+    inline bool probe_tt(TTEntry& entry);
+
+    template <SearchMode SM>
+    inline PositionScore quiescence_search(PositionScore alpha, PositionScore beta);
+
+    template <SearchMode SM>
+    inline PositionScore negamax(int depth, PositionScore alpha, PositionScore beta, bool cut_node);
+
+    template <SearchMode SM>
+    inline PositionScore pvs(int depth, PositionScore alpha, PositionScore beta, bool first_move, bool cut_node, int reduction = 0);
+
+    inline int late_move_reduction(int depth, int move_number, bool is_pv, Move move);
+
+    inline Move previous_pv_move(int ply) const;
+
+    inline void update_quiet_stats(Move best_move, bool best_is_quiet, const MoveList& quiets_searched, int depth);
+
+    template <SearchMode SM>
+    Move search_at_depth(SearchDepth depth, PositionScore alpha, PositionScore beta, Move prev_best_move, PositionScore& best_score);
+
+    template <SearchMode SM>
+    Move aspiration_search(SearchDepth depth, PositionScore& score);
+
+    void print_info(SearchDepth depth, PositionScore score) const;
+};
+
+Searcher::Searcher() : tt(DEFAULT_HASH_MB) {}
+
+// Defined here since SearchWorker is incomplete in the header
+Searcher::~Searcher() = default;
+
+void Searcher::set_threads(int threads) {
+    num_threads = std::clamp(threads, 1, MAX_THREADS);
+}
+
+bool Searcher::set_hash(size_t mb) {
+    return tt.resize(mb, num_threads);
+}
+
+// Uses all search threads to clear the table since large tables take a while to clear
+void Searcher::clear_hash() {
+    tt.clear(num_threads);
+}
+
+void Searcher::clear_history() {
+    for (const auto& worker : workers) {
+        worker->ss.clear_history();
+    }
+}
+
+TTStats Searcher::tt_stats() const {
+    TTStats stats;
+    for (const auto& worker : workers) {
+        stats += worker->ss.tt_stats;
+    }
+    return stats;
+}
+
+uint64_t Searcher::total_nodes() const {
+    uint64_t nodes = 0;
+    for (const auto& worker : workers) {
+        nodes += worker->ss.nodes.load(std::memory_order_relaxed);
+    }
+    return nodes;
+}
+
 template <SearchMode SM>
-static inline bool should_stop_search() {
-    // Stop when the search interrupted flag is set or if stop is requested via UCI
-    if (ss.search_interrupted || stop_requested) {
+inline bool SearchWorker::should_stop_search() {
+    // Stop when the search interrupted flag is set, if stop is requested via UCI or
+    // if the main thread has finished searching
+    if (ss.search_interrupted || searcher.stop_requested || searcher.stop_helpers) {
         return true;
     }
 
+    uint64_t nodes = ss.nodes.load(std::memory_order_relaxed);
+
     if constexpr (SM == TIME) {
         // Check if the search has exceeded its time limit (if search mode is TIME)
         // Only check every N nodes (where N = TIME_CHECK_PERIOD_MASK + 1)
         return (
-            (ss.nodes & TIME_CHECK_PERIOD_MASK) == 0
+            (nodes & TIME_CHECK_PERIOD_MASK) == 0
             && std::chrono::steady_clock::now() >= ss.deadline
         );
     } else if constexpr (SM == NODES) {
         // Check if search has exceeded the number of nodes to search (if search mode is NODE)
-        return ss.nodes >= ss.limits.nodes;
+        // With a single thread we can check our own counter exactly. Otherwise, only the main
+        // thread periodically sums the counters of all threads (helpers are stopped by main)
+        if (searcher.num_threads == 1) {
+            return nodes >= ss.limits.nodes;
+        }
+
+        return (
+            is_main()
+            && (nodes & TIME_CHECK_PERIOD_MASK) == 0
+            && searcher.total_nodes() >= ss.limits.nodes
+        );
     } else {
         // In all other cases, we shouldn't stop the search
         // INFINITE = keep going forever (or until stop flag)
@@ -63,38 +304,7 @@ static inline bool should_stop_search() {
     }
 }
 
-static inline int score_move(Move m) {
-    return m.is_promotion() ? 3 : m.type() == CAPTURE ? 2 : 1;
-}
-
-template <bool UsePrevBestMove>
-static inline void order_moves(Board& b, MoveList& moves, Move prev_best_move = NULL_MOVE) {
-    // Store the TT move if we have a hit
-    Move tt_move;
-    TTEntry tt_entry = TT.get_entry(b.zobrist_hash);
-    if (TT.is_valid_entry(b.zobrist_hash, tt_entry)) {
-        tt_move = tt_entry.best_move;
-    }
-
-    // Prioritize promotions, captures, then quiet moves (in that order)
-    std::sort(moves.begin(), moves.end(), [prev_best_move, tt_move](const Move& m1, const Move& m2) {
-        // Always try the previous best move first if we have it
-        if constexpr (UsePrevBestMove) {
-            if (m1 == prev_best_move) return true;
-            if (m2 == prev_best_move) return false;
-        }
-
-        // Then try the TT move if we have one
-        if (tt_move != NULL_MOVE) {
-            if (m1 == tt_move) return true;
-            if (m2 == tt_move) return false;
-        }
-
-        return score_move(m1) > score_move(m2);
-    });
-}
-
-// Normalizes checkmate scores from absolute ply to relative distance
+// Normalizes checkmate scores from distance to the root to distance to the current node
 // This helps determine how far the mate is from the current ply if this score is retrieved
 // from the transposition table
 static inline PositionScore normalize_tt_score(PositionScore score, int ply) {
@@ -117,9 +327,31 @@ static inline PositionScore denormalize_tt_score(PositionScore score, int ply) {
     return score;
 }
 
+// Probes the transposition table for the current position and records the statistics
+// The 16 bit key can match another position, which shows when the stored move isn't legal
+// here. Such entries are treated as misses since their score belongs to another position
+inline bool SearchWorker::probe_tt(TTEntry& entry) {
+    ss.tt_stats.probes++;
+    if (!tt.probe(b.zobrist_hash, entry)) {
+        return false;
+    }
+
+    if (entry.best_move != NULL_MOVE && !is_legal_move(b, entry.best_move)) {
+        ss.tt_stats.move_mismatches++;
+        return false;
+    }
+
+    ss.tt_stats.hits++;
+    return true;
+}
+
 template <SearchMode SM>
-static inline PositionScore quiescence_search(Board& b, PositionScore alpha, PositionScore beta) {
-    ss.nodes++;
+inline PositionScore SearchWorker::quiescence_search(PositionScore alpha, PositionScore beta) {
+    ss.increment_nodes();
+
+    // The principal variation ends with the moves of the main search
+    int ply = search_ply();
+    ss.pv_table[ply].length = 0;
 
     if (should_stop_search<SM>()) {
         ss.search_interrupted = true;
@@ -128,105 +360,366 @@ static inline PositionScore quiescence_search(Board& b, PositionScore alpha, Pos
 
     bool in_check = b.in_check();
 
+    // Quiescence results are stored with depth 0, so any entry for the position is deep
+    // enough for a cutoff
+    TTEntry tt_entry;
+    bool tt_hit = probe_tt(tt_entry);
+
+    if (tt_hit) {
+        PositionScore tt_score = denormalize_tt_score(tt_entry.score, search_ply());
+        if (
+            tt_entry.node() == EXACT
+            || (tt_entry.node() == FAIL_HIGH && tt_score >= beta)
+            || (tt_entry.node() == FAIL_LOW && tt_score <= alpha)
+        ) {
+            ss.tt_stats.cutoffs++;
+            return tt_score;
+        }
+    }
+
     // First, we get a static evaluation of the position without searching any captures or promotions
     // This serves as a baseline to prevent forcing bad tactical moves
     // Additionally, we can stop the search early if the static evaluation is higher than the beta cutoff
     // This can only be done if we're not in check - otherwise we MUST make a move
+    // Scores are fail-soft: we return the best score found even if it's outside the window
+    PositionScore original_alpha = alpha;
+    PositionScore static_eval = DUMMY_SCORE;
+    PositionScore best_score = MIN_SCORE;
     if (!in_check) {
-        PositionScore static_eval = evaluate(b);
-        alpha = std::max(alpha, static_eval);
-        if (alpha >= beta) {
-            return beta;
+        static_eval = evaluate(b);
+        best_score = static_eval;
+        if (best_score >= beta) {
+            return best_score;
         }
+        alpha = std::max(alpha, best_score);
     }
 
-    // If we're not in check, search captures and promotions. Otherwise, search all moves (evasions)
-    MoveList moves = in_check ? generate_moves<ALL>(b) : generate_moves<CAPTURES_AND_PROMOTIONS>(b);
-    if (moves.is_empty()) {
-        if (in_check) {
-            // In check + no legal moves - checkmate
-            return -CHECKMATE_SCORE + b.ply;
-        }
+    // If we're not in check, search captures and promotions (losing captures are skipped by
+    // the selector). Otherwise, search all moves (evasions)
+    MoveSelector selector(tt_hit ? tt_entry.best_move : NULL_MOVE, ply, !in_check);
+    int moves_seen = 0;
+    Move best_move;
 
-        // No captures or promotions available, return early
-        return alpha;
-    }
+    Move move;
+    while ((move = selector.next_move(b, ss)) != NULL_MOVE) {
+        moves_seen++;
+
+        // Delta pruning: if even winning the captured material (plus a margin) can't raise
+        // the static eval to alpha, the capture is hopeless. Its optimistic score still
+        // counts as a bound on the node's score
+        if (!in_check) {
+            PositionScore optimistic_score = static_eval + material_gain(b, move) + DELTA_MARGIN;
+            if (optimistic_score <= alpha) {
+                best_score = std::max(best_score, optimistic_score);
+                continue;
+            }
+        }
 
-    for (Move move : moves) {
+        tt.prefetch(b.key_after(move));
+        ss.set_current_move(b, ply, move);
         b.make_move(move);
-        PositionScore score = -quiescence_search<SM>(b, -beta, -alpha);
+        PositionScore score = -quiescence_search<SM>(-beta, -alpha);
         b.unmake_move(move);
 
         if (ss.search_interrupted) {
             return SEARCH_INTERRUPTED;
         }
 
-        alpha = std::max(alpha, score);
-        if (alpha >= beta) {
-            break;
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+            }
+            if (alpha >= beta) {
+                break;
+            }
         }
     }
 
-    return alpha;
+    // In check + no legal moves - checkmate
+    if (in_check && moves_seen == 0) {
+        return -CHECKMATE_SCORE + search_ply();
+    }
+
+    // Entries from the main search are deeper, so they're kept even if they're for this position
+    if (!tt_hit || tt_entry.depth == 0) {
+        TTNode tt_node = best_score >= beta ? FAIL_HIGH : best_score > original_alpha ? EXACT : FAIL_LOW;
+        if (tt.store(b.zobrist_hash, best_move, 0, normalize_tt_score(best_score, search_ply()), tt_node)) {
+            ss.tt_stats.deeper_overwrites++;
+        }
+    }
+
+    return best_score;
 }
 
 template <SearchMode SM>
-static inline PositionScore negamax(Board& b, SearchDepth depth, PositionScore alpha, PositionScore beta) {
-    ss.nodes++;
+inline PositionScore SearchWorker::negamax(int depth, PositionScore alpha, PositionScore beta, bool cut_node) {
+    ss.increment_nodes();
 
     if (should_stop_search<SM>()) {
         ss.search_interrupted = true;
         return SEARCH_INTERRUPTED; // Dummy value (for semantics) - will not be used
     }
 
-    if (depth == 0) {
-        return quiescence_search<SM>(b, alpha, beta);
+    // Depth can drop below zero after reductions
+    if (depth <= 0) {
+        return quiescence_search<SM>(alpha, beta);
     }
 
-    MoveList moves = generate_moves<ALL>(b);
-    order_moves<false>(b, moves);
+    // Nodes searched with a zero window only need to prove a bound, so we can prune them
+    // more aggressively than nodes on the principal variation
+    bool is_pv = beta - alpha > 1;
+    bool in_check = b.in_check();
+    int ply = search_ply();
 
-    // Side to move has no remaining moves
-    if (moves.is_empty()) {
-        if (b.in_check()) {
-            // If we're in check with no moves, then that is a checkmate
-            // Add ply to the score to incentivize drawing out the game for the
-            // losing side or ending the game quicker for the winning side
-            return -CHECKMATE_SCORE + b.ply;
-        } else {
-            // If we're not in check with no moves, then that is a stalemate
-            return STALEMATE_SCORE;
-        }
+    // Set while checking whether the hash move of this node is singular, in which case this
+    // node is searched without it. Its result doesn't belong to the position, so the TT is
+    // left alone and nothing is pruned based on the position alone
+    Move excluded_move = ss.stack[ply].excluded_move;
+    bool excluding = excluded_move != NULL_MOVE;
+
+    // The line of this node is only built once a move raises alpha. The search for a
+    // singular move shares the ply with the node it was started from, so it leaves the line alone
+    if (!excluding) {
+        ss.pv_table[ply].length = 0;
     }
 
     // Probe transposition table
-    TTEntry& tt_entry = TT.get_entry(b.zobrist_hash);
-    if (TT.is_valid_entry(b.zobrist_hash, tt_entry)) {
-        // Denormalize score before returning
-        PositionScore tt_score = denormalize_tt_score(tt_entry.score, b.ply);
+    TTEntry tt_entry;
+    bool tt_hit = !excluding && probe_tt(tt_entry);
+    PositionScore tt_score = tt_hit ? denormalize_tt_score(tt_entry.score, search_ply()) : DUMMY_SCORE;
 
+    if (tt_hit) {
         // We can use the TT entry score to cutoff early if the depth of the entry
         // is greater than or equal to the current depth of this node.
         // Furthermore, we must be able to cutoff based on the type of the node.
         if (
             tt_entry.depth >= depth
             && (
-                tt_entry.node == EXACT
-                || (tt_entry.node == FAIL_HIGH && tt_score >= beta)
-                || (tt_entry.node == FAIL_LOW && tt_score <= alpha)
+                tt_entry.node() == EXACT
+                || (tt_entry.node() == FAIL_HIGH && tt_score >= beta)
+                || (tt_entry.node() == FAIL_LOW && tt_score <= alpha)
             )
         ) {
+            ss.tt_stats.cutoffs++;
             return tt_score;
         }
     }
 
+    // Static evaluation of the node, which the pruning below uses to guess whether a search
+    // is needed at all. There is no static eval in check since we must respond to the check
+    PositionScore static_eval = in_check ? DUMMY_SCORE : evaluate(b);
+    ss.stack[ply].static_eval = static_eval;
+
+    // Improving: our eval went up since our last move. Nodes that aren't improving are
+    // less likely to fail high, so they're pruned more aggressively
+    bool improving = !in_check && ply >= 2 && static_eval > ss.stack[ply - 2].static_eval;
+
+    // Reverse futility pruning: if the static eval beats beta by a wide margin, then a
+    // search is almost sure to fail high as well
+    if (
+        !is_pv
+        && !in_check
+        && !excluding
+        && depth <= RFP_MAX_DEPTH
+        && std::abs(beta) < CHECKMATE_SCORE - MAX_PLY
+        && static_eval - RFP_MARGIN * (depth - improving) >= beta
+    ) {
+        return static_eval;
+    }
+
+    // Razoring: if the static eval is far below alpha, only tactics could save the node,
+    // which is what quiescence search looks at
+    if (
+        !is_pv
+        && !in_check
+        && !excluding
+        && depth <= RAZOR_MAX_DEPTH
+        && static_eval + RAZOR_MARGIN * depth < alpha
+    ) {
+        PositionScore score = quiescence_search<SM>(alpha, alpha + 1);
+        if (ss.search_interrupted) {
+            return SEARCH_INTERRUPTED;
+        }
+        if (score <= alpha) {
+            return score;
+        }
+    }
+
+    // Null move pruning: if we pass the turn and a reduced search still fails high, then
+    // the position is so good that making an actual move would almost surely fail high too
+    // This doesn't hold in zugzwang, where any move makes the position worse. Zugzwang is
+    // common in pawn endgames, so we skip those, and deep cutoffs are verified by searching
+    // the position again without null moves. Two null moves in a row would just give back
+    // the same position, and null moves can't be made in check.
+    if (
+        !is_pv
+        && !in_check
+        && !excluding
+        && !verifying_null_move
+        && depth >= NMP_MIN_DEPTH
+        && b.moves[b.ply - 1] != NULL_MOVE
+        && b.has_non_pawn_material(b.to_move)
+        && std::abs(beta) < CHECKMATE_SCORE - MAX_PLY
+    ) {
+        if (static_eval >= beta) {
+            int reduction = NMP_BASE_REDUCTION + depth / NMP_DEPTH_DIVISOR
+                + std::min((static_eval - beta) / NMP_EVAL_DIVISOR, NMP_MAX_EVAL_REDUCTION);
+
+            ss.set_current_move(b, ply, NULL_MOVE);
+            b.make_null_move();
+            PositionScore score = -negamax<SM>(depth - 1 - reduction, -beta, -beta + 1, !cut_node);
+            b.unmake_null_move();
+
+            if (ss.search_interrupted) {
+                return SEARCH_INTERRUPTED;
+            }
+
+            if (score >= beta) {
+                // Mate scores after a null move aren't proven since the null move isn't legal
+                if (score >= CHECKMATE_SCORE - MAX_PLY) {
+                    score = beta;
+                }
+
+                if (depth < NMP_VERIFICATION_DEPTH) {
+                    return score;
+                }
+
+                verifying_null_move = true;
+                PositionScore verification_score = negamax<SM>(depth - reduction, beta - 1, beta, false);
+                verifying_null_move = false;
+
+                if (ss.search_interrupted) {
+                    return SEARCH_INTERRUPTED;
+                }
+
+                if (verification_score >= beta) {
+                    return score;
+                }
+            }
+        }
+    }
+
+    // On the previous iteration's principal variation, its move is tried first (its TT entry
+    // may have been overwritten since)
+    Move pv_move = is_pv ? previous_pv_move(ply) : NULL_MOVE;
+    Move hash_move = pv_move != NULL_MOVE ? pv_move : tt_hit ? tt_entry.best_move : NULL_MOVE;
+
+    // Internal iterative reductions: without a hash move the move ordering is poor, so
+    // searching this node at full depth is expensive. In nodes where that matters (PV and
+    // expected cut nodes), the depth is reduced so that a cheaper search finds a hash move
+    // that the next iteration can use instead
+    if (
+        (is_pv || cut_node)
+        && !excluding
+        && depth >= IIR_MIN_DEPTH
+        && hash_move == NULL_MOVE
+    ) {
+        depth--;
+    }
+
     // Store original alpha value for this node to determine if it's a fail-low TT node
     PositionScore original_alpha = alpha;
+    PositionScore best_score = MIN_SCORE;
     Move best_move;
 
-    for (Move move : moves) {
+    MoveSelector selector(hash_move, ply);
+
+    // Number of legal moves handed out by the selector before the current one
+    int i = -1;
+
+    // Quiet moves that were searched without causing a cutoff (penalized on a cutoff)
+    MoveList quiets_searched;
+
+    // Extensions are limited to twice the iteration's depth so that lines with many checks
+    // can't blow up the search
+    bool can_extend = ply < 2 * root_depth && ply < MAX_DEPTH;
+
+    Move move;
+    while ((move = selector.next_move(b, ss)) != NULL_MOVE) {
+        if (move == excluded_move) {
+            continue;
+        }
+
+        i++;
+
+        // Late move reductions: thanks to move ordering, moves late in the list rarely turn
+        // out to be best, so quiet ones are searched with less depth first
+        bool is_quiet = !move.is_tactical();
+
+        // Once a move has been searched (so we can't return a score without searching any
+        // move), quiet moves may be skipped at shallow depth in non-PV nodes
+        bool can_prune_quiet = !is_pv && !in_check && is_quiet && i > 0
+            && best_score > -CHECKMATE_SCORE + MAX_PLY;
+
+        // Late move pruning: the later a quiet move comes in the move order, the less likely
+        // it is to be good, so after enough moves the rest are skipped
+        if (
+            can_prune_quiet
+            && depth <= LMP_MAX_DEPTH
+            && i >= (LMP_BASE + depth * depth) / (improving ? 1 : 2)
+        ) {
+            continue;
+        }
+
+        // Futility pruning: a quiet move rarely gains more than the margin, so if the static
+        // eval plus the margin can't raise alpha, the move is skipped
+        if (
+            can_prune_quiet
+            && depth <= FP_MAX_DEPTH
+            && static_eval + FP_BASE_MARGIN + FP_MARGIN * depth <= alpha
+        ) {
+            continue;
+        }
+
+        // Singular extensions: if every other move fails low against a bound somewhat below
+        // the hash move's score, the hash move is the only good move and is searched deeper.
+        // If instead another move also beats that bound and the bound is above beta, several
+        // moves fail high, so the node is very likely to fail high as well (multi-cut)
+        int extension = 0;
+        if (
+            can_extend
+            && tt_hit
+            && depth >= SE_MIN_DEPTH
+            && move == tt_entry.best_move
+            && tt_entry.node() != FAIL_LOW
+            && tt_entry.depth >= depth - SE_TT_DEPTH_MARGIN
+            && std::abs(tt_score) < CHECKMATE_SCORE - MAX_PLY
+        ) {
+            PositionScore singular_beta = tt_score - SE_MARGIN * depth;
+
+            ss.stack[ply].excluded_move = move;
+            PositionScore score = negamax<SM>((depth - 1) / 2, singular_beta - 1, singular_beta, cut_node);
+            ss.stack[ply].excluded_move = NULL_MOVE;
+
+            if (ss.search_interrupted) {
+                return SEARCH_INTERRUPTED;
+            }
+
+            if (score < singular_beta) {
+                extension = 1;
+            } else if (singular_beta >= beta) {
+                return singular_beta;
+            }
+        }
+
+        bool can_reduce = depth >= LMR_MIN_DEPTH && i >= LMR_MIN_MOVES + is_pv && is_quiet && !in_check;
+        int reduction = can_reduce ? late_move_reduction(depth, i, is_pv, move) : 0;
+
+        tt.prefetch(b.key_after(move));
+        ss.set_current_move(b, ply, move);
         b.make_move(move);
-        PositionScore score = -negamax<SM>(b, depth - 1, -beta, -alpha);
+
+        // Check extensions: the reply to a check is forced, so checks are searched one ply
+        // deeper to see where they lead. Checks are also often the point of a quiet move, so
+        // they get one ply less of reduction
+        if (b.in_check()) {
+            if (can_extend) extension = 1;
+            if (reduction > 0) reduction--;
+        }
+
+        PositionScore score = pvs<SM>(depth - 1 + extension, alpha, beta, i == 0, cut_node, reduction);
         b.unmake_move(move);
 
         // Discard the score and return early if the search has been interrupted
@@ -234,68 +727,197 @@ static inline PositionScore negamax(Board& b, SearchDepth depth, PositionScore a
             return SEARCH_INTERRUPTED;
         }
 
-        // Update lower bound and determine if we need to prune this branch
-        if (score > alpha) {
-            alpha = score;
-            best_move = move;
+        // Scores are fail-soft: the best score is kept even when it's outside the window,
+        // which gives tighter bounds in the TT
+        if (score > best_score) {
+            best_score = score;
+
+            // Update lower bound and determine if we need to prune this branch
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+
+                if (!excluding) {
+                    ss.pv_table[ply].update(move, ss.pv_table[ply + 1]);
+                }
+            }
         }
 
         if (alpha >= beta) {
+            update_quiet_stats(move, is_quiet, quiets_searched, depth);
             break;
         }
+
+        if (is_quiet) {
+            quiets_searched.add(move);
+        }
+    }
+
+    // When the only legal move is excluded, the node fails low (which extends that move)
+    if (i == -1 && excluding) {
+        return alpha;
+    }
+
+    // Side to move has no legal moves
+    if (i == -1) {
+        // If we're in check with no moves, then that is a checkmate
+        // Add the distance from the root to the score to incentivize drawing out the game
+        // for the losing side or ending the game quicker for the winning side (counting from
+        // the root rather than the start of the game keeps mate scores within MAX_PLY)
+        // If we're not in check with no moves, then that is a stalemate
+        return in_check ? -CHECKMATE_SCORE + search_ply() : STALEMATE_SCORE;
+    }
+
+    if (excluding) {
+        return best_score;
     }
 
     // Determine the type of entry based on the final score
     TTNode tt_node;
-    if (alpha >= beta) {
+    if (best_score >= beta) {
         tt_node = FAIL_HIGH;
-    } else if (alpha <= original_alpha) {
+    } else if (best_score <= original_alpha) {
         tt_node = FAIL_LOW;
     } else {
         tt_node = EXACT;
     }
 
     // Normalize score before storing
-    PositionScore tt_score = normalize_tt_score(alpha, b.ply);
+    PositionScore stored_score = normalize_tt_score(best_score, search_ply());
 
     // Store TT entry
-    TT.add_entry(TTEntry{b.zobrist_hash, best_move, depth, tt_score, tt_node});
+    if (tt.store(b.zobrist_hash, best_move, depth, stored_score, tt_node)) {
+        ss.tt_stats.deeper_overwrites++;
+    }
+
+    return best_score;
+}
+
+// Searches the child position of a move that was just made (principal variation search)
+// The first move is expected to be the best, so it is searched with the full window. The
+// remaining moves only need to be proven worse than it, which a zero window search around
+// alpha does much more cheaply. If one of them turns out better after all, it's searched
+// again with the full window to get its exact score.
+// A reduced move that beats alpha is first searched again at full depth (still with a zero
+// window) since the reduced search may have missed why the move is bad.
+// cut_node is whether the node the move is made from is expected to fail high, which makes
+// the child of its first move an expected fail low, and the zero window searches of the
+// other moves expected fail highs (the children of PV nodes are PV nodes or cut nodes).
+template <SearchMode SM>
+inline PositionScore SearchWorker::pvs(int depth, PositionScore alpha, PositionScore beta, bool first_move, bool cut_node, int reduction) {
+    bool is_pv = beta - alpha > 1;
+
+    if (first_move) {
+        return -negamax<SM>(depth, -beta, -alpha, !is_pv && !cut_node);
+    }
+
+    PositionScore score = -negamax<SM>(depth - reduction, -alpha - 1, -alpha, true);
+    if (score > alpha && reduction > 0 && !ss.search_interrupted) {
+        score = -negamax<SM>(depth, -alpha - 1, -alpha, !cut_node);
+    }
+    if (score > alpha && score < beta && !ss.search_interrupted) {
+        score = -negamax<SM>(depth, -beta, -alpha, false);
+    }
+
+    return score;
+}
+
+// Reduction for a quiet move, based on the reduction table and adjusted for the node type
+// and how the move ordering heuristics rate the move. Never reduces into quiescence search.
+inline int SearchWorker::late_move_reduction(int depth, int move_number, bool is_pv, Move move) {
+    int reduction = LMR_REDUCTIONS[std::min(depth, MAX_DEPTH)][std::min(move_number, MAX_MOVES - 1)];
+
+    // The principal variation is worth searching more accurately
+    if (is_pv) reduction--;
+
+    // Killers refuted a sibling position and the countermove refuted the opponent's last
+    // move elsewhere, so they're likely good here too
+    int ply = search_ply();
+    if (move == ss.killer_1[ply] || move == ss.killer_2[ply] || move == ss.countermove(b)) reduction--;
+
+    // Moves that often caused cutoffs elsewhere (or after the same moves) are reduced less
+    reduction -= ss.quiet_history(b, ply, move) / LMR_HISTORY_DIVISOR;
+
+    return std::clamp(reduction, 0, depth - 2);
+}
 
-    return alpha;
+// Rewards the move that caused a beta cutoff if it's quiet (killers, countermove and history), and
+// penalizes the quiet moves that were searched before it, since ordering them first was
+// a waste of time
+inline void SearchWorker::update_quiet_stats(Move best_move, bool best_is_quiet, const MoveList& quiets_searched, int depth) {
+    int ply = search_ply();
+    int bonus = std::min(HISTORY_BONUS_MULTIPLIER * depth * depth, HISTORY_MAX_BONUS);
+
+    if (best_is_quiet) {
+        ss.update_killers(ply, best_move);
+        ss.update_countermove(b, best_move);
+        ss.update_history(b, ply, best_move, bonus);
+    }
+
+    for (Move move : quiets_searched) {
+        ss.update_history(b, ply, move, -bonus);
+    }
 }
 
-// Searches all root moves at a given depth and returns the best move
+// The move of the previous iteration's principal variation at ply, if the moves leading to
+// this node follow it (NULL_MOVE otherwise)
+inline Move SearchWorker::previous_pv_move(int ply) const {
+    if (ply >= pv.length) return NULL_MOVE;
+
+    for (int i = 0; i < ply; i++) {
+        if (ss.stack[i].move != pv.moves[i]) return NULL_MOVE;
+    }
+    return pv.moves[ply];
+}
+
+// Searches all root moves at a given depth within the window [alpha, beta] and returns the
+// best move (and its score via best_score)
+// Alpha serves as our lower bound (best score so far at this depth). Beta serves as our
+// upper bound - if we find a move better than beta then that move is too good and our
+// opponent won't allow it (it's worse for them than their lower bound)
+// The returned score is fail-soft, so a score outside the window tells the caller which
+// side the search failed on
 template <SearchMode SM>
-static Move search_at_depth(Board& b, SearchDepth depth, Move prev_best_move) {
+Move SearchWorker::search_at_depth(SearchDepth depth, PositionScore alpha, PositionScore beta, Move prev_best_move, PositionScore& best_score) {
     Move best_move;
+    best_score = MIN_SCORE;
 
-    // Alpha will serve as our lower bound (best score so far at this depth)
-    PositionScore alpha = MIN_SCORE;
+    PositionScore original_alpha = alpha;
+    uint64_t start_nodes = ss.nodes.load(std::memory_order_relaxed);
+    best_move_nodes = 0;
 
-    // Beta will serve as our upper bound - if we find a move better than beta
-    // then that move is too good and our opponent won't allow it (it's worse
-    // for them than their lower bound)
-    PositionScore beta = MAX_SCORE;
+    // The previous iteration's best move comes first, otherwise the hash move
+    TTEntry tt_entry;
+    bool tt_hit = probe_tt(tt_entry);
+    Move first_move = prev_best_move != NULL_MOVE ? prev_best_move : tt_hit ? tt_entry.best_move : NULL_MOVE;
 
-    MoveList moves = generate_moves<ALL>(b);
-    order_moves<true>(b, moves, prev_best_move);
+    MoveSelector selector(first_move, 0);
+
+    Move move;
+    for (int i = 0; (move = selector.next_move(b, ss)) != NULL_MOVE; i++) {
+        uint64_t move_start_nodes = ss.nodes.load(std::memory_order_relaxed);
 
-    for (Move move : moves) {
+        tt.prefetch(b.key_after(move));
+        ss.set_current_move(b, 0, move);
         b.make_move(move);
-        PositionScore score = -negamax<SM>(b, depth - 1, -beta, -alpha);
+        PositionScore score = pvs<SM>(depth - 1, alpha, beta, i == 0, false);
         b.unmake_move(move);
 
-        // Same here - return early if the search is interrutpted, otherwise negate
-        // the score to process it for the parent
+        // Same here - return early if the search is interrutpted
+        // The moves searched so far are still usable if one of them beat the window's lower
+        // bound, since it's then better than what the previous iteration expected
         if (ss.search_interrupted) {
-            return NULL_MOVE;
+            return best_score > original_alpha ? best_move : NULL_MOVE;
         }
 
         // If we found a move better than the current best move at this depth,
-        // update the best score (alpha) and the best move at this depth
-        if (score > alpha) {
-            alpha = score;
+        // update the best score and the best move at this depth
+        if (score > best_score) {
+            best_score = score;
             best_move = move;
+            best_move_nodes = ss.nodes.load(std::memory_order_relaxed) - move_start_nodes;
+            alpha = std::max(alpha, score);
+            ss.pv_table[0].update(move, ss.pv_table[1]);
         }
 
         // If the move we found is too good and our opponent will not allow it (because
@@ -308,41 +930,191 @@ static Move search_at_depth(Board& b, SearchDepth depth, Move prev_best_move) {
         }
     }
 
+    root_nodes = ss.nodes.load(std::memory_order_relaxed) - start_nodes;
     return best_move;
 }
 
-// Initializes search globals and performs iterative deepening search
+
+// Prints a UCI info line for the last completed iteration of the main thread
+void SearchWorker::print_info(SearchDepth depth, PositionScore score) const {
+    auto elapsed = std::chrono::steady_clock::now() - ss.start_time;
+    uint64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    uint64_t nodes = searcher.total_nodes();
+    uint64_t nps = nodes * 1000 / std::max<uint64_t>(ms, 1);
+
+    // Report mate scores as the number of moves (not plies) until mate
+    std::string score_str;
+    if (score >= CHECKMATE_SCORE - MAX_PLY) {
+        score_str = "mate " + std::to_string((CHECKMATE_SCORE - score + 1) / 2);
+    } else if (score <= -CHECKMATE_SCORE + MAX_PLY) {
+        score_str = "mate -" + std::to_string((CHECKMATE_SCORE + score) / 2);
+    } else {
+        score_str = "cp " + std::to_string(score);
+    }
+
+    std::cout << "info depth " << static_cast<int>(depth)
+              << " score " << score_str
+              << " nodes " << nodes
+              << " nps " << nps
+              << " hashfull " << tt.hashfull()
+              << " time " << ms
+              << " pv";
+    for (int i = 0; i < pv.length; i++) {
+        std::cout << " " << decode_move_to_uci(pv.moves[i]);
+    }
+    std::cout << "\n";
+    std::cout.flush();
+}
+
+// Searches the root with a narrow window around the previous iteration's score, since
+// the score rarely changes much between iterations and narrow windows prune more.
+// When the score falls outside the window, the window is widened on that side and the
+// iteration is searched again.
 template <SearchMode SM>
-Move search(Board& b, const SearchLimits& limits) {
-    ss.limits = limits;
-    ss.nodes = 0;
-    ss.search_interrupted = false;
+Move SearchWorker::aspiration_search(SearchDepth depth, PositionScore& score) {
+    PositionScore alpha = MIN_SCORE;
+    PositionScore beta = MAX_SCORE;
+    int window = ASPIRATION_WINDOW;
 
-    // Calculate search deadline based on time limit if search mode is TIME
-    if constexpr (SM == TIME) {
-        ss.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.time);
+    // Mate scores are too far from everything else for a narrow window to help
+    bool is_mate_score = std::abs(best_score) >= CHECKMATE_SCORE - MAX_PLY;
+    if (depth >= ASPIRATION_MIN_DEPTH && best_move != NULL_MOVE && !is_mate_score) {
+        alpha = std::max<int>(best_score - window, MIN_SCORE);
+        beta = std::min<int>(best_score + window, MAX_SCORE);
     }
 
-    SearchDepth depth = 1;
-    Move best_move;
+    while (true) {
+        Move move = search_at_depth<SM>(depth, alpha, beta, best_move, score);
+        if (ss.search_interrupted) {
+            return move;
+        }
+
+        // The true score is at most score, so lower alpha (and pull beta towards it)
+        if (score <= alpha && alpha > MIN_SCORE) {
+            beta = (alpha + beta) / 2;
+            alpha = std::max<int>(score - window, MIN_SCORE);
+        }
+        // The true score is at least score, so raise beta
+        else if (score >= beta && beta < MAX_SCORE) {
+            beta = std::min<int>(score + window, MAX_SCORE);
+        } else {
+            return move;
+        }
+
+        window *= 2;
+    }
+}
+
+// Iterative deepening loop run by every thread
+template <SearchMode SM>
+void SearchWorker::iterative_deepening() {
+    // Helpers start at different depths so that threads don't all search the
+    // same iteration in lockstep
+    SearchDepth depth = 1 + (id & 1);
 
     // Iterative search loop
-    while (!should_stop_search<SM>()) {
+    while (!should_stop_search<SM>() && depth <= MAX_DEPTH) {
         // Check if we've hit the max depth if search mode is DEPTH
         if constexpr (SM == DEPTH) {
             if (depth > ss.limits.depth) break;
         }
 
-        Move best_move_at_depth = search_at_depth<SM>(b, depth, best_move);
+        root_depth = depth;
+        PositionScore score = DUMMY_SCORE;
+        Move best_move_at_depth = aspiration_search<SM>(depth, score);
+
+        // An interrupted iteration may still have found a better move (see search_at_depth)
+        if (ss.search_interrupted) {
+            if (best_move_at_depth != NULL_MOVE) {
+                best_move = best_move_at_depth;
+                best_score = score;
+                pv = ss.pv_table[0];
+            }
+            break;
+        }
 
         if (best_move_at_depth != NULL_MOVE) {
             best_move = best_move_at_depth;
+            best_score = score;
+            pv = ss.pv_table[0];
+            completed_depth = depth;
+
+            if (is_main()) print_info(depth, best_score);
         }
 
-        if (ss.search_interrupted) break;
+        // The main thread decides whether there's enough time for another iteration
+        if constexpr (SM == TIME) {
+            if (is_main()) {
+                auto elapsed = std::chrono::steady_clock::now() - ss.start_time;
+                int ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+                double best_move_fraction = root_nodes == 0 ? 1.0 : static_cast<double>(best_move_nodes) / root_nodes;
+
+                if (!searcher.time_manager.should_start_iteration(ms, best_move, best_score, best_move_fraction)) {
+                    break;
+                }
+            }
+        }
 
         depth++;
     }
+}
+
+// Starts the helper threads, runs the main search and picks the best move among all threads
+template <SearchMode SM>
+Move Searcher::search(Board& b, const SearchLimits& limits) {
+    auto start_time = std::chrono::steady_clock::now();
+    this->limits = limits;
+    stop_helpers = false;
+
+    if constexpr (SM == TIME) {
+        if (limits.clock.remaining >= 0) time_manager.init(limits.clock);
+        else                             time_manager.init(limits.time);
+    }
+    tt.new_search();
+
+    // Only create workers for new threads so that the others keep their history
+    workers.resize(std::min<size_t>(workers.size(), num_threads));
+    while (workers.size() < static_cast<size_t>(num_threads)) {
+        workers.push_back(std::make_unique<SearchWorker>(*this, workers.size()));
+    }
+
+    for (const auto& worker : workers) {
+        worker->new_search(b);
+
+        SearchState& ss = worker->ss;
+        ss.start_time = start_time;
+
+        // Calculate search deadline based on time limit if search mode is TIME
+        if constexpr (SM == TIME) {
+            ss.deadline = start_time + std::chrono::milliseconds(time_manager.hard_limit());
+        }
+    }
+
+    // Start helpers and search on this thread as the main thread
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < num_threads; i++) {
+        helpers.emplace_back([this, i]() { workers[i]->iterative_deepening<SM>(); });
+    }
+
+    SearchWorker& main_worker = *workers[0];
+    main_worker.iterative_deepening<SM>();
+
+    // Once the main thread is done, stop and wait for the helpers
+    stop_helpers = true;
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    // Pick the best move from the thread that completed the deepest iteration
+    // (ties go to the main thread)
+    SearchWorker* best_worker = &main_worker;
+    for (const auto& worker : workers) {
+        if (worker->completed_depth > best_worker->completed_depth && worker->best_move != NULL_MOVE) {
+            best_worker = worker.get();
+        }
+    }
+    Move best_move = best_worker->best_move;
+    pv = best_worker->pv;
 
     // In the rare case where we have legal moves at this position, but we weren't able
     // to complete our first search (depth = 1), we return an arbitrary move
@@ -351,7 +1123,7 @@ Move search(Board& b, const SearchLimits& limits) {
 }
 
 // Explicit template instantiations
-template Move search<TIME>(Board& b, const SearchLimits& limits);
-template Move search<NODES>(Board& b, const SearchLimits& limits);
-template Move search<DEPTH>(Board& b, const SearchLimits& limits);
-template Move search<INFINITE>(Board& b, const SearchLimits& limits);
+template Move Searcher::search<TIME>(Board& b, const SearchLimits& limits);
+template Move Searcher::search<NODES>(Board& b, const SearchLimits& limits);
+template Move Searcher::search<DEPTH>(Board& b, const SearchLimits& limits);
+template Move Searcher::search<INFINITE>(Board& b, const SearchLimits& limits);
\ No newline at end of file
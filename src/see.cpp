@@ -0,0 +1,164 @@
+#include <array>
+
+#include "see.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+#include "precompute.hpp"
+#include "board.hpp"
+#include "move_generator.hpp"
+
+// The longest possible exchange on a single square (every piece on the board takes part)
+constexpr int MAX_EXCHANGE_LENGTH = 32;
+
+// All pieces (of both colors) attacking a square, given an occupancy
+static inline Bitboard attackers_to(const Board& b, Square sq, Bitboard occupied) {
+    Bitboard diagonal_sliders = b.pieces[WHITE][BISHOP] | b.pieces[BLACK][BISHOP] | b.pieces[WHITE][QUEEN] | b.pieces[BLACK][QUEEN];
+    Bitboard straight_sliders = b.pieces[WHITE][ROOK] | b.pieces[BLACK][ROOK] | b.pieces[WHITE][QUEEN] | b.pieces[BLACK][QUEEN];
+
+    // A piece on sq attacks a white pawn's square exactly when a white pawn there attacks sq,
+    // so the pawn maps are indexed by the color of the pawn
+    return
+        (PAWN_ATTACK_MAPS[WHITE][sq] & b.pieces[WHITE][PAWN]) |
+        (PAWN_ATTACK_MAPS[BLACK][sq] & b.pieces[BLACK][PAWN]) |
+        (KNIGHT_ATTACK_MAP[sq] & (b.pieces[WHITE][KNIGHT] | b.pieces[BLACK][KNIGHT])) |
+        (KING_ATTACK_MAP[sq] & (b.pieces[WHITE][KING] | b.pieces[BLACK][KING])) |
+        (generate_sliding_attack_mask<BISHOP>(occupied, sq) & diagonal_sliders) |
+        (generate_sliding_attack_mask<ROOK>(occupied, sq) & straight_sliders);
+}
+
+// Removes the least valuable of the given attackers from the occupancy, adds any slider
+// it was hiding to the attackers, and returns the piece type (NO_PIECE if there are none)
+static inline Piece pop_least_valuable_attacker(const Board& b, Square sq, Color color, Bitboard& attackers, Bitboard& occupied) {
+    for (Piece piece = PAWN; piece <= KING; piece++) {
+        Bitboard candidates = attackers & b.pieces[color][piece];
+        if (!candidates) continue;
+
+        Bitboard mask = get_mask(get_lsb(candidates));
+        occupied ^= mask;
+        attackers ^= mask;
+
+        // Only pieces on a line with sq can uncover a slider behind them (knights and kings can't)
+        if (piece == PAWN || piece == BISHOP || piece == QUEEN) {
+            Bitboard diagonal_sliders = b.pieces[WHITE][BISHOP] | b.pieces[BLACK][BISHOP] | b.pieces[WHITE][QUEEN] | b.pieces[BLACK][QUEEN];
+            attackers |= generate_sliding_attack_mask<BISHOP>(occupied, sq) & diagonal_sliders & occupied;
+        }
+        if (piece == ROOK || piece == QUEEN) {
+            Bitboard straight_sliders = b.pieces[WHITE][ROOK] | b.pieces[BLACK][ROOK] | b.pieces[WHITE][QUEEN] | b.pieces[BLACK][QUEEN];
+            attackers |= generate_sliding_attack_mask<ROOK>(occupied, sq) & straight_sliders & occupied;
+        }
+
+        return piece;
+    }
+
+    return NO_PIECE;
+}
+
+static inline Piece promotion_piece(Move move) {
+    switch (move.flag()) {
+        case PROMOTION_BISHOP: return BISHOP;
+        case PROMOTION_KNIGHT: return KNIGHT;
+        case PROMOTION_ROOK:   return ROOK;
+        case PROMOTION_QUEEN:  return QUEEN;
+        default:               return NO_PIECE;
+    }
+}
+
+int material_gain(const Board& b, Move move) {
+    Piece victim = captured_piece(b, move);
+    int gain = victim == NO_PIECE ? 0 : PIECE_VALUE[victim];
+
+    Piece promoted = promotion_piece(move);
+    if (promoted != NO_PIECE) gain += PIECE_VALUE[promoted] - PIECE_VALUE[PAWN];
+    return gain;
+}
+
+// Occupancy right after the move is made (the captured en passant pawn is removed as well)
+static inline Bitboard occupancy_after(const Board& b, Move move) {
+    Bitboard occupied = (b.occupied ^ get_mask(move.from())) | get_mask(move.to());
+    if (move.flag() == EN_PASSANT) {
+        Square captured_sq = b.to_move == WHITE ? move.to() - 8 : move.to() + 8;
+        occupied ^= get_mask(captured_sq);
+    }
+    return occupied;
+}
+
+int see(const Board& b, Move move) {
+    // Castling can't be recaptured and never wins material
+    if (move.flag() == CASTLE) return 0;
+
+    Square to = move.to();
+    Piece promoted = promotion_piece(move);
+    Piece on_square = promoted != NO_PIECE ? promoted : b.piece_map[move.from()];
+
+    Bitboard occupied = occupancy_after(b, move);
+    Bitboard attackers = attackers_to(b, to, occupied) & occupied;
+
+    // gain[i] is the balance for the side making capture i if the exchange stopped right after it
+    std::array<int, MAX_EXCHANGE_LENGTH> gain;
+    gain[0] = material_gain(b, move);
+
+    int depth = 0;
+    Color color = b.to_move;
+    while (depth + 1 < MAX_EXCHANGE_LENGTH) {
+        color ^= 1;
+        Piece attacker = pop_least_valuable_attacker(b, to, color, attackers, occupied);
+        if (attacker == NO_PIECE) break;
+
+        // A king may only recapture if the other side has nothing left to take it with
+        if (attacker == KING && (attackers & b.colors[color ^ 1])) break;
+
+        depth++;
+        gain[depth] = PIECE_VALUE[on_square] - gain[depth - 1];
+        on_square = attacker;
+    }
+
+    // Unwind the swap list: each side picks the better of stopping or continuing
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+
+    return gain[0];
+}
+
+bool see_ge(const Board& b, Move move, int threshold) {
+    if (move.flag() == CASTLE) return 0 >= threshold;
+
+    Square to = move.to();
+    Piece promoted = promotion_piece(move);
+    Piece on_square = promoted != NO_PIECE ? promoted : b.piece_map[move.from()];
+
+    // Even if the moved piece isn't recaptured, the move doesn't reach the threshold
+    int swap = material_gain(b, move) - threshold;
+    if (swap < 0) return false;
+
+    // Even if the moved piece is lost, the move still reaches the threshold
+    swap = PIECE_VALUE[on_square] - swap;
+    if (swap <= 0) return true;
+
+    Bitboard occupied = occupancy_after(b, move);
+    Bitboard attackers = attackers_to(b, to, occupied) & occupied;
+
+    // result is whether the side that made the last capture reaches the threshold (from the
+    // moving side's point of view), and swap is what the side to capture next has to win back
+    Color color = b.to_move;
+    int result = 1;
+    while (true) {
+        color ^= 1;
+        Piece attacker = pop_least_valuable_attacker(b, to, color, attackers, occupied);
+        if (attacker == NO_PIECE) break;
+
+        result ^= 1;
+
+        // A king can only recapture if the other side has no attackers left
+        if (attacker == KING) {
+            return (attackers & b.colors[color ^ 1]) ? result ^ 1 : result;
+        }
+
+        // Stop once the capturing side keeps its result even if it loses the capturing piece
+        swap = PIECE_VALUE[attacker] - swap;
+        if (swap < result) break;
+    }
+
+    return result;
+}
@@ -1,4 +1,6 @@
 #include <filesystem>
+#include <memory>
+#include <sstream>
 #include <vector>
 #include <string>
 
@@ -7,6 +9,15 @@
 #include "types.hpp"
 #include "board.hpp"
 #include "utils.hpp"
+#include "move_generator.hpp"
+#include "move_selector.hpp"
+#include "see.hpp"
+#include "search.hpp"
+
+const int NUM_LEGAL_MOVE_TEST_POSITIONS = 500;
+const int NUM_PV_TEST_POSITIONS = 50;
+const SearchDepth PV_TEST_DEPTH = 6;
+const SearchDepth MATE_TEST_DEPTH = 4;
 
 struct SanTestCase {
     std::string fen;
@@ -119,8 +130,338 @@ static bool test_parse_move_from_fen(Board& b) {
     return true;
 }
 
+static bool test_is_legal_move(Board& b) {
+    std::vector<std::string> buffer;
+    read_file(buffer, DOUBLE_CHECK_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+    read_file(buffer, EN_PASSANT_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+    read_file(buffer, MIXED_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+
+    for (const auto& line : buffer) {
+        auto result = parse_perft_epd_line(line);
+
+        // Load position
+        b.reset();
+        b.load_from_fen(result.fen);
+
+        // Mark all moves from the move generator as legal
+        std::vector<bool> is_generated(1 << 16, false);
+        for (Move move : generate_moves<ALL>(b)) {
+            is_generated[move.move] = true;
+        }
+
+        // Every possible move encoding should be accepted if and only if it was generated
+        for (uint32_t encoding = 0; encoding < (1 << 16); encoding++) {
+            Move move;
+            move.move = encoding;
+
+            if (is_legal_move(b, move) != is_generated[encoding]) {
+                std::clog << "[FAILURE] 'is_legal_move' - Expected move " << decode_move_to_uci(move)
+                    << " (encoding " << encoding << ") to be " << (is_generated[encoding] ? "legal" : "illegal") << "\n";
+                std::clog << "FEN: " << result.fen << "\n";
+                return false;
+            }
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
+static bool test_key_after(Board& b) {
+    std::vector<std::string> buffer;
+    read_file(buffer, EN_PASSANT_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+    read_file(buffer, MIXED_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+
+    for (const auto& line : buffer) {
+        auto result = parse_perft_epd_line(line);
+
+        // Load position
+        b.reset();
+        b.load_from_fen(result.fen);
+
+        for (Move move : generate_moves<ALL>(b)) {
+            // key_after doesn't account for the rook in a castle or the pawn captured en passant
+            if (move.flag() == CASTLE || move.flag() == EN_PASSANT) continue;
+
+            uint64_t expected_key = b.key_after(move);
+            b.make_move(move);
+            uint64_t key = b.zobrist_hash;
+            b.unmake_move(move);
+
+            if (key != expected_key) {
+                std::clog << "[FAILURE] 'key_after' - Predicted key doesn't match the key after making "
+                    << decode_move_to_uci(move) << "\n";
+                std::clog << "FEN: " << result.fen << "\n";
+                return false;
+            }
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
+static bool test_null_move(Board& b) {
+    std::vector<std::string> buffer;
+    read_file(buffer, EN_PASSANT_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+    read_file(buffer, MIXED_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+
+    Board expected;
+    for (const auto& line : buffer) {
+        auto result = parse_perft_epd_line(line);
+
+        // Load position
+        b.reset();
+        b.load_from_fen(result.fen);
+        if (b.in_check()) continue;
+
+        // The position after a null move is the same position with the other side to move
+        // and no en passant target
+        std::istringstream iss(result.fen);
+        std::string placement, side, castling;
+        iss >> placement >> side >> castling;
+        expected.reset();
+        expected.load_from_fen(placement + " " + (side == "w" ? "b" : "w") + " " + castling + " -");
+
+        uint64_t original_key = b.zobrist_hash;
+        Square original_en_passant_target = b.en_passant_target;
+
+        b.make_null_move();
+        if (b.zobrist_hash != expected.zobrist_hash || b.to_move != expected.to_move) {
+            std::clog << "[FAILURE] 'null_move' - Key after null move doesn't match the key of the position\n";
+            std::clog << "FEN: " << result.fen << "\n";
+            return false;
+        }
+
+        b.unmake_null_move();
+        if (b.zobrist_hash != original_key || b.en_passant_target != original_en_passant_target) {
+            std::clog << "[FAILURE] 'null_move' - Unmaking the null move didn't restore the position\n";
+            std::clog << "FEN: " << result.fen << "\n";
+            return false;
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
+static bool test_move_selector(Board& b) {
+    std::vector<std::string> buffer;
+    read_file(buffer, DOUBLE_CHECK_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+    read_file(buffer, EN_PASSANT_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+    read_file(buffer, MIXED_EPD, NUM_LEGAL_MOVE_TEST_POSITIONS);
+
+    // Heap allocated, the history tables are large
+    auto ss = std::make_unique<SearchState>();
+
+    for (const auto& line : buffer) {
+        auto result = parse_perft_epd_line(line);
+
+        // Load position
+        b.reset();
+        b.load_from_fen(result.fen);
+
+        MoveList moves = generate_moves<ALL>(b);
+
+        // Use the last legal move as the hash move and the first two as killers, so
+        // that every stage has to skip moves handed out by an earlier one
+        Move tt_move = moves.is_empty() ? NULL_MOVE : moves[moves.size - 1];
+
+        // Captures only mode skips losing captures (unless it's the hash move)
+        MoveList captures;
+        for (Move move : generate_moves<CAPTURES_AND_PROMOTIONS>(b)) {
+            if (move == tt_move || see_ge(b, move, 0)) captures.add(move);
+        }
+        ss->killer_1[0] = moves.size > 0 ? moves[0] : NULL_MOVE;
+        ss->killer_2[0] = moves.size > 1 ? moves[1] : NULL_MOVE;
+
+        for (bool captures_only : {false, true}) {
+            const MoveList& expected = captures_only ? captures : moves;
+            std::vector<int> times_seen(1 << 16, 0);
+            int count = 0;
+
+            MoveSelector selector(tt_move, 0, captures_only);
+            Move move;
+            while ((move = selector.next_move(b, *ss)) != NULL_MOVE) {
+                times_seen[move.move]++;
+                count++;
+            }
+
+            // Every expected move should be handed out exactly once
+            bool valid = count == expected.size;
+            for (Move expected_move : expected) {
+                valid = valid && times_seen[expected_move.move] == 1;
+            }
+
+            if (!valid) {
+                std::clog << "[FAILURE] 'move_selector' - Expected " << expected.size << " moves"
+                    << (captures_only ? " (captures only)" : "") << ", but the selector returned " << count << "\n";
+                std::clog << "FEN: " << result.fen << "\n";
+                return false;
+            }
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
+static bool test_see(Board& b) {
+    struct SeeTestCase {
+        std::string fen;
+        std::string move;
+        int expected;
+    };
+
+    SeeTestCase test_cases[] = {
+        // Undefended pawn
+        {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100},
+        // Knight for a pawn, the rook behind the knight can't win it back
+        {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -200},
+        // Defended pawn, but the second rook (x-ray) wins the exchange back
+        {"3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", 100},
+        // Defended pawn and only one rook
+        {"3rk3/8/8/3p4/8/8/8/3RK3 w - - 0 1", "d1d5", -400},
+        // En passant
+        {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100},
+        // Promotion on a defended square loses the queen (but wins back the pawn's value)
+        {"3rk3/2P5/8/8/8/8/8/4K3 w - - 0 1", "c7c8q", -100},
+        // The king recaptures, unless the piece is defended (by an x-ray here)
+        {"4k3/8/8/8/8/8/3q4/3RK3 b - - 0 1", "d2d1", -400},
+        {"4k3/8/8/3r4/8/8/3q4/3RK3 b - - 0 1", "d2d1", 500},
+        {"4k3/8/8/8/8/8/3q4/4K3 b - - 0 1", "d2d1", -900},
+    };
+
+    for (const auto& test : test_cases) {
+        // Load position
+        b.reset();
+        b.load_from_fen(test.fen);
+
+        Move move = NULL_MOVE;
+        for (Move legal_move : generate_moves<ALL>(b)) {
+            if (decode_move_to_uci(legal_move) == test.move) move = legal_move;
+        }
+
+        if (move == NULL_MOVE) {
+            std::clog << "[FAILURE] 'see' - " << test.move << " isn't a legal move\n";
+            std::clog << "FEN: " << test.fen << "\n";
+            return false;
+        }
+
+        int value = see(b, move);
+        if (value != test.expected) {
+            std::clog << "[FAILURE] 'see' - Expected " << test.expected << " for " << test.move << ", but got " << value << "\n";
+            std::clog << "FEN: " << test.fen << "\n";
+            return false;
+        }
+
+        // see_ge should agree with the exact value on both sides of it
+        if (!see_ge(b, move, value) || see_ge(b, move, value + 1)) {
+            std::clog << "[FAILURE] 'see_ge' - Doesn't agree with see (" << value << ") for " << test.move << "\n";
+            std::clog << "FEN: " << test.fen << "\n";
+            return false;
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
+static bool test_principal_variation(Board& b) {
+    std::vector<std::string> buffer;
+    read_file(buffer, MIXED_EPD, NUM_PV_TEST_POSITIONS);
+
+    Searcher searcher;
+
+    for (const auto& line : buffer) {
+        auto result = parse_perft_epd_line(line);
+
+        // Load position
+        b.reset();
+        b.load_from_fen(result.fen);
+
+        // Silence the search's info lines
+        std::streambuf* cout_buffer = std::cout.rdbuf(nullptr);
+        Move best_move = searcher.search_depth(b, PV_TEST_DEPTH);
+        std::cout.rdbuf(cout_buffer);
+
+        // The line should start with the best move and be playable from the position
+        const PrincipalVariation& pv = searcher.principal_variation();
+        bool valid = best_move == NULL_MOVE ? pv.length == 0 : pv.length > 0 && pv.moves[0] == best_move;
+        for (int i = 0; valid && i < pv.length; i++) {
+            valid = is_legal_move(b, pv.moves[i]);
+            if (valid) b.make_move(pv.moves[i]);
+        }
+
+        if (!valid) {
+            std::clog << "[FAILURE] 'principal_variation' - Got an illegal line for best move "
+                << decode_move_to_uci(best_move) << ":";
+            for (int i = 0; i < pv.length; i++) {
+                std::clog << " " << decode_move_to_uci(pv.moves[i]);
+            }
+            std::clog << "\nFEN: " << result.fen << "\n";
+            return false;
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
+// Mate scores are reported relative to the root, no matter how many moves were played before it
+static bool test_mate_score(Board& b) {
+    struct MateTestCase {
+        std::vector<std::string> moves;
+        std::string expected_score;
+    };
+
+    std::vector<MateTestCase> tests = {
+        // Fool's mate
+        {{"f2f3", "e7e5", "g2g4"}, "score mate 1 "},
+        // Scholar's mate
+        {{"e2e4", "e7e5", "f1c4", "b8c6", "d1h5", "g8f6"}, "score mate 1 "},
+    };
+
+    Searcher searcher;
+
+    for (const auto& test : tests) {
+        b.reset();
+        b.load_from_fen();
+        for (const auto& move : test.moves) {
+            b.make_move(encode_move_from_uci(b, move));
+        }
+
+        // Capture the search's info lines to check the reported score
+        std::ostringstream output;
+        std::streambuf* cout_buffer = std::cout.rdbuf(output.rdbuf());
+        searcher.search_depth(b, MATE_TEST_DEPTH);
+        std::cout.rdbuf(cout_buffer);
+
+        std::string info = output.str();
+        size_t last_line = info.rfind("info depth");
+        if (last_line == std::string::npos || info.find(test.expected_score, last_line) == std::string::npos) {
+            std::clog << "[FAILURE] 'mate_score' - Expected '" << test.expected_score << "' after moves";
+            for (const auto& move : test.moves) {
+                std::clog << " " << move;
+            }
+            std::clog << "\nGot: " << (last_line == std::string::npos ? "no info line" : info.substr(last_line));
+            return false;
+        }
+    }
+
+    // All tests passed
+    return true;
+}
+
 void run_tests() {
     Board b;
     if (test_in_check(b)) std::clog << "[SUCCESS] 'in_check'\n";
     if (test_parse_move_from_fen(b)) std::clog << "[SUCCESS] 'parse_move_from_fen'\n";
+    if (test_is_legal_move(b)) std::clog << "[SUCCESS] 'is_legal_move'\n";
+    if (test_key_after(b)) std::clog << "[SUCCESS] 'key_after'\n";
+    if (test_null_move(b)) std::clog << "[SUCCESS] 'null_move'\n";
+    if (test_move_selector(b)) std::clog << "[SUCCESS] 'move_selector'\n";
+    if (test_see(b)) std::clog << "[SUCCESS] 'see'\n";
+    if (test_principal_variation(b)) std::clog << "[SUCCESS] 'principal_variation'\n";
+    if (test_mate_score(b)) std::clog << "[SUCCESS] 'mate_score'\n";
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <array>
+
+#include "time_manager.hpp"
+#include "types.hpp"
+#include "move.hpp"
+
+// Without movestogo, we plan as if this many moves were left in the game
+constexpr int DEFAULT_MOVES_TO_GO = 30;
+constexpr int MAX_MOVES_TO_GO     = 50;
+
+// Fractions of the remaining time that the limits of a single move may never exceed
+constexpr double MAX_SOFT_FRACTION = 0.5;
+constexpr double MAX_HARD_FRACTION = 0.75;
+
+// The hard limit leaves room for the soft limit to grow this much
+constexpr int HARD_LIMIT_FACTOR = 4;
+
+// Soft limit scale by the number of iterations in a row with the same best move
+constexpr std::array<double, 5> STABILITY_SCALE = {2.2, 1.4, 1.0, 0.85, 0.75};
+
+// Soft limit scale per centipawn that the score dropped since the last iteration (and the
+// bounds of that scale)
+constexpr double SCORE_DROP_SCALE = 0.005;
+constexpr double MIN_SCORE_DROP_SCALE = 0.8;
+constexpr double MAX_SCORE_DROP_SCALE = 1.6;
+
+// Soft limit scale by the fraction of nodes spent on the best move: (BASE - fraction) * FACTOR
+constexpr double BEST_MOVE_NODES_BASE = 1.5;
+constexpr double BEST_MOVE_NODES_FACTOR = 1.35;
+
+void TimeManager::init(int time) {
+    soft = time;
+    hard = time;
+    adaptive = false;
+}
+
+void TimeManager::init(const TimeControl& clock) {
+    int moves_to_go = clock.moves_to_go > 0 ? std::min(clock.moves_to_go, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+    // The overhead is lost on this move (later moves account for theirs when they're searched)
+    int time_left = std::max(clock.remaining - clock.move_overhead, 1);
+
+    soft = std::min<int>(time_left / moves_to_go + clock.increment * 3 / 4, time_left * MAX_SOFT_FRACTION);
+    hard = std::min<int>(soft * HARD_LIMIT_FACTOR, time_left * MAX_HARD_FRACTION);
+
+    // Always leave time for at least the first iteration
+    soft = std::max(soft, 1);
+    hard = std::max(hard, soft);
+
+    adaptive = true;
+    previous_best_move = NULL_MOVE;
+    previous_score = DUMMY_SCORE;
+    stability = 0;
+}
+
+bool TimeManager::should_start_iteration(int elapsed, Move best_move, PositionScore score, double best_move_nodes) {
+    if (!adaptive) {
+        return elapsed < soft;
+    }
+
+    // Best move stability: a best move that survived several iterations is unlikely to change
+    stability = best_move == previous_best_move ? std::min<int>(stability + 1, STABILITY_SCALE.size() - 1) : 0;
+    double scale = STABILITY_SCALE[stability];
+
+    // Score drop: a falling score means the search found a problem, which is worth resolving
+    if (previous_score != DUMMY_SCORE) {
+        scale *= std::clamp(1.0 + (previous_score - score) * SCORE_DROP_SCALE, MIN_SCORE_DROP_SCALE, MAX_SCORE_DROP_SCALE);
+    }
+
+    // Best move nodes: when the other moves were refuted quickly, the best move is clear
+    scale *= (BEST_MOVE_NODES_BASE - best_move_nodes) * BEST_MOVE_NODES_FACTOR;
+
+    previous_best_move = best_move;
+    previous_score = score;
+
+    return elapsed < std::min<int>(soft * scale, hard);
+}
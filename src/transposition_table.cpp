@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "transposition_table.hpp"
+#include "memory.hpp"
+
+TranspositionTable::TranspositionTable(size_t mb) {
+    resize(mb);
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+bool TranspositionTable::resize(size_t mb, int threads) {
+    mb = std::clamp(mb, MIN_HASH_MB, MAX_HASH_MB);
+
+    // Free the old table first so that we don't need memory for both at once
+    std::string name = shared_name;
+    release();
+
+    if (!name.empty() && attach_shared(name, mb)) {
+        return true;
+    }
+
+    bool success = allocate(mb);
+    if (!success && !allocate(DEFAULT_HASH_MB)) {
+        std::clog << "Error: Failed to allocate transposition table\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    clear(threads);
+    return success;
+}
+
+bool TranspositionTable::allocate(size_t mb) {
+    bucket_count = mb * 1024 * 1024 / sizeof(TTBucket);
+    memory = allocate_large_pages(bucket_count * sizeof(TTBucket));
+    table = static_cast<TTBucket*>(memory.ptr);
+    return table != nullptr;
+}
+
+// Runs fn(start, end) over [0, count) with the range split into one chunk per thread
+template <typename Fn>
+static void parallel_for_range(uint64_t count, int threads, Fn fn) {
+    if (threads <= 1) {
+        fn(0, count);
+        return;
+    }
+
+    uint64_t chunk_size = (count + threads - 1) / threads;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        uint64_t start = i * chunk_size;
+        uint64_t end = std::min(start + chunk_size, count);
+        if (start >= end) break;
+
+        workers.emplace_back(fn, start, end);
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void TranspositionTable::release() {
+    if (is_shared()) {
+        unmap_shared_memory(shared);
+    } else {
+        free_large_pages(memory);
+    }
+
+    shared_name.clear();
+    table = nullptr;
+    bucket_count = 0;
+}
+
+bool TranspositionTable::share(const std::string& name, int threads) {
+    size_t mb = size_mb();
+    release();
+
+    if (name.empty()) {
+        return resize(mb, threads);
+    }
+
+    if (attach_shared(name, mb)) {
+        return true;
+    }
+
+    // Fall back to a private table of the same size
+    resize(mb, threads);
+    return false;
+}
+
+void TranspositionTable::clear(int threads) {
+    // Empty entries are all zeros (NO_TT_ENTRY = 0), so we can just memset the table
+    // Large tables take a while to clear, so the work is split across threads
+    parallel_for_range(bucket_count, threads, [this](uint64_t start, uint64_t end) {
+        std::memset(static_cast<void*>(table + start), 0, (end - start) * sizeof(TTBucket));
+    });
+}
+
+static TTFileHeader make_tt_header(uint64_t bucket_count, uint8_t generation) {
+    TTFileHeader header{};
+    std::memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+    header.version = TT_FILE_VERSION;
+    header.bucket_size = sizeof(TTBucket);
+    header.zobrist_fingerprint = ZOBRIST_FINGERPRINT;
+    header.bucket_count = bucket_count;
+    header.generation = generation;
+    return header;
+}
+
+bool TranspositionTable::save(const std::string& path) const {
+    TTFileHeader header = make_tt_header(bucket_count, generation);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table), bucket_count * sizeof(TTBucket));
+    return file.good();
+}
+
+// Checks that the file was written by a compatible build and that its size matches the header
+static bool is_valid_tt_file(const TTFileHeader& header, uint64_t file_size) {
+    constexpr uint64_t MB = 1024 * 1024;
+    uint64_t table_size = header.bucket_count * sizeof(TTBucket);
+
+    return std::memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == TT_FILE_VERSION
+        && header.bucket_size == sizeof(TTBucket)
+        && header.zobrist_fingerprint == ZOBRIST_FINGERPRINT
+        && header.bucket_count > 0
+        && table_size % MB == 0
+        && table_size / MB >= MIN_HASH_MB && table_size / MB <= MAX_HASH_MB
+        && file_size == sizeof(TTFileHeader) + table_size;
+}
+
+// Shared segments start with the same header as hash files, which lets processes check
+// that they agree on the table layout and key set before sharing entries
+bool TranspositionTable::attach_shared(const std::string& name, size_t mb) {
+    uint64_t requested_bucket_count = mb * 1024 * 1024 / sizeof(TTBucket);
+    shared = map_shared_memory(name, sizeof(TTFileHeader) + requested_bucket_count * sizeof(TTBucket));
+    if (!is_shared()) return false;
+
+    // The version is written last, so a non-zero version means the header is complete
+    // New segments are zero filled, which is an empty table
+    TTFileHeader* header = static_cast<TTFileHeader*>(shared.ptr);
+    std::atomic_ref<uint32_t> version(header->version);
+    if (shared.created) {
+        TTFileHeader new_header = make_tt_header(requested_bucket_count, 0);
+        new_header.version = 0;
+        *header = new_header;
+        version.store(TT_FILE_VERSION, std::memory_order_release);
+    } else {
+        // Give the process that created the segment a moment to write the header
+        for (int i = 0; i < 1000 && version.load(std::memory_order_acquire) == 0; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    if (!is_valid_tt_file(*header, shared.size)) {
+        unmap_shared_memory(shared);
+        return false;
+    }
+
+    shared_name = name;
+    table = reinterpret_cast<TTBucket*>(header + 1);
+    bucket_count = header->bucket_count;
+    return true;
+}
+
+template <typename ReadFn>
+bool TranspositionTable::load_buckets(const TTFileHeader& header, int threads, ReadFn read) {
+    // The table is never resized to fit the file: that would silently override the Hash
+    // option, and a failed allocation would leave neither the old nor the loaded table
+    if (bucket_count != header.bucket_count) {
+        return false;
+    }
+
+    parallel_for_range(bucket_count, threads, [this, &read](uint64_t start, uint64_t end) {
+        read(table, start, end);
+    });
+
+    generation = header.generation;
+    return true;
+}
+
+bool TranspositionTable::load(const std::string& path, int threads) {
+#if defined(__linux__)
+    // Map the file and copy the buckets straight out of the page cache
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(TTFileHeader)) {
+        close(fd);
+        return false;
+    }
+
+    size_t file_size = st.st_size;
+    void* ptr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) return false;
+
+    // The whole file is read once from start to end
+    madvise(ptr, file_size, MADV_SEQUENTIAL);
+    madvise(ptr, file_size, MADV_WILLNEED);
+
+    const char* data = static_cast<const char*>(ptr);
+    TTFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    bool success = is_valid_tt_file(header, file_size)
+        && load_buckets(header, threads, [data](TTBucket* dest, uint64_t start, uint64_t end) {
+            std::memcpy(
+                static_cast<void*>(dest + start),
+                data + sizeof(TTFileHeader) + start * sizeof(TTBucket),
+                (end - start) * sizeof(TTBucket)
+            );
+        });
+
+    munmap(ptr, file_size);
+    return success;
+#else
+    // Without mmap, read the buckets into the table with a single read
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    uint64_t file_size = file.tellg();
+    file.seekg(0);
+
+    TTFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+
+    if (!is_valid_tt_file(header, file_size)) return false;
+
+    bool success = load_buckets(header, 1, [&file](TTBucket* dest, uint64_t start, uint64_t end) {
+        file.read(reinterpret_cast<char*>(dest + start), (end - start) * sizeof(TTBucket));
+    });
+    if (!success) return false;
+
+    // Don't keep a partially read table
+    if (!file) {
+        clear();
+        return false;
+    }
+
+    return true;
+#endif
+}
@@ -1,33 +1,39 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <charconv>
+#include <cstdint>
 
 #include "types.hpp"
 #include "board.hpp"
 #include "search.hpp"
 #include "utils.hpp"
 #include "move.hpp"
+#include "memory.hpp"
+#include "precompute.hpp"
 
 std::thread search_thread;
-std::atomic<bool> stop_requested(false);
+
+// File used by the SaveHash and LoadHash options
+const std::string DEFAULT_HASH_FILE = "enigma.hash";
+std::string hash_file = DEFAULT_HASH_FILE;
+
+// Set by the Move Overhead option
+int move_overhead = DEFAULT_MOVE_OVERHEAD_MS;
 
 // Stops the search and joins the thread to prevent any dangling threads/race conditions
-static void clean_up_thread() {
-    stop_requested = true;
+static void clean_up_thread(Searcher& searcher) {
+    searcher.stop_requested = true;
 
     if (search_thread.joinable()) {
         search_thread.join();
     }
 
-    stop_requested = false;
-}
-
-// Calculates how much time to spend on the search in milliseconds
-static int calc_time_limit(int remaining, int increment) {
-    return remaining / 20 + increment / 2;
+    searcher.stop_requested = false;
 }
 
 static void print(const std::string& str) {
@@ -35,22 +41,128 @@ static void print(const std::string& str) {
     std::cout.flush();
 }
 
-static void cmd_uci() {
+// Reports the size of the hash and whether the large tables ended up backed by huge pages
+static void print_hash_info(Searcher& searcher) {
+    print("info string Hash " + std::to_string(searcher.hash_size_mb()) + " MB uses "
+        + page_mode_name(searcher.hash_page_mode())
+        + (searcher.hash_is_shared() ? " (shared)" : ""));
+}
+
+static void print_page_modes(Searcher& searcher) {
+    print(std::string("info string Attack tables use ") + page_mode_name(ATTACK_TABLE_MEMORY.mode));
+    print_hash_info(searcher);
+}
+
+static void cmd_uci(Searcher& searcher) {
     print("id name Enigma");
     print("id author Syed Zaidi");
+    print("option name Hash type spin default " + std::to_string(DEFAULT_HASH_MB)
+        + " min " + std::to_string(MIN_HASH_MB) + " max " + std::to_string(MAX_HASH_MB));
+    print("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_THREADS));
+    print("option name Move Overhead type spin default " + std::to_string(DEFAULT_MOVE_OVERHEAD_MS)
+        + " min 0 max " + std::to_string(MAX_MOVE_OVERHEAD_MS));
+    print("option name HashFile type string default " + DEFAULT_HASH_FILE);
+    print("option name SharedHash type string default <empty>");
+    print("option name RemoveSharedHash type button");
+    print("option name SaveHash type button");
+    print("option name LoadHash type button");
+    // Reported during the handshake so that the page modes still end up in the GUI's logs
+    print_page_modes(searcher);
     print("uciok");
 }
 
-static void cmd_setoption(const std::string& cmd) {
-    // TODO
+// Parses the value of a spin option (already checked with is_pos_int) and clamps it to the
+// option's bounds. Values too large to parse are clamped to the maximum instead of throwing
+static uint64_t parse_spin(const std::string& value, uint64_t min, uint64_t max) {
+    uint64_t result = max;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec == std::errc::result_out_of_range) result = max;
+    return std::clamp(result, min, max);
+}
+
+static void cmd_setoption(const std::string& cmd, Searcher& searcher) {
+    // Parse setoption command in the form: setoption name [NAME] value [VALUE]
+    std::istringstream iss(cmd);
+    std::string token, name, value;
+    iss >> token; // Discard "setoption" token
+
+    // Option names and values may contain spaces
+    bool reading_value = false;
+    while (iss >> token) {
+        if (token == "name") {
+            reading_value = false;
+        } else if (token == "value") {
+            reading_value = true;
+        } else if (reading_value) {
+            value += value.empty() ? token : " " + token;
+        } else {
+            name += name.empty() ? token : " " + token;
+        }
+    }
+
+    // Options can't be changed while searching
+    clean_up_thread(searcher);
+
+    if (name == "Hash" && is_pos_int(value)) {
+        size_t mb = parse_spin(value, MIN_HASH_MB, MAX_HASH_MB);
+        if (!searcher.set_hash(mb)) {
+            print("info string Failed to allocate " + std::to_string(mb) + " MB of hash, using default size");
+        }
+        print_hash_info(searcher);
+    } else if (name == "Threads" && is_pos_int(value)) {
+        searcher.set_threads(static_cast<int>(parse_spin(value, 1, MAX_THREADS)));
+    } else if (name == "Move Overhead" && is_pos_int(value)) {
+        move_overhead = static_cast<int>(parse_spin(value, 0, MAX_MOVE_OVERHEAD_MS));
+    } else if (name == "HashFile" && !value.empty()) {
+        hash_file = value;
+    } else if (name == "SharedHash") {
+        // The segment name must start with a slash (e.g. /enigma)
+        if (value.empty() || value == "<empty>") {
+            searcher.share_hash("");
+        } else if (!searcher.share_hash(value.starts_with("/") ? value : "/" + value)) {
+            print("info string Failed to share hash as " + value + ", using private hash");
+        }
+        print_hash_info(searcher);
+    } else if (name == "RemoveSharedHash") {
+        // The segment is freed once every process using it switches away or exits
+        // This process keeps using it until the next Hash or SharedHash change, which goes private
+        if (searcher.remove_shared_hash()) {
+            print("info string Removed shared hash, the next Hash change will use a private hash");
+        } else {
+            print("info string No shared hash to remove");
+        }
+    } else if (name == "SaveHash") {
+        if (searcher.save_hash(hash_file)) {
+            print("info string Saved hash to " + hash_file);
+        } else {
+            print("info string Failed to save hash to " + hash_file);
+        }
+    } else if (name == "LoadHash") {
+        if (searcher.load_hash(hash_file)) {
+            print("info string Loaded hash from " + hash_file);
+        } else {
+            print("info string Failed to load hash from " + hash_file
+                + " (missing file, or incompatible with the current Hash size)");
+        }
+        print_hash_info(searcher);
+    } else {
+        print("info string Unknown option '" + name + "'");
+    }
 }
 
 static void cmd_isready() {
     print("readyok");
 }
 
-static void cmd_ucinewgame(Board& b) {
+// The transposition table is only cleared on a new game (not on every position command)
+// so that work from previous searches carries over to the next move
+// A shared table is never cleared since other processes are still using it
+static void cmd_ucinewgame(Board& b, Searcher& searcher) {
     b.reset();
+    searcher.clear_history();
+    if (!searcher.hash_is_shared()) {
+        searcher.clear_hash();
+    }
 }
 
 static void cmd_position(const std::string& cmd, Board& b) {
@@ -81,9 +193,9 @@ static void cmd_position(const std::string& cmd, Board& b) {
     }
 }
 
-static void cmd_go(std::string& cmd, Board& b) {
+static void cmd_go(std::string& cmd, Board& b, Searcher& searcher) {
     // Parse go command
-    int wtime = -1, btime = -1, winc = 0, binc = 0;
+    int wtime = -1, btime = -1, winc = 0, binc = 0, movestogo = 0;
     int movetime = -1, nodes = -1, depth = -1;
     bool infinite = false;
     std::istringstream iss(cmd);
@@ -92,14 +204,20 @@ static void cmd_go(std::string& cmd, Board& b) {
     // TODO: implement remaining go options
     iss >> token;
     while (iss >> token) {
+        // A flagged (negative) clock is still a clock: it gets the minimum allocation
+        // rather than being mistaken for no clock at all
         if (token == "wtime") {
             iss >> wtime;
+            wtime = std::max(wtime, 0);
         } else if (token == "btime") {
             iss >> btime;
+            btime = std::max(btime, 0);
         } else if (token == "winc") {
             iss >> winc;
         } else if (token == "binc") {
             iss >> binc;
+        } else if (token == "movestogo") {
+            iss >> movestogo;
         } else if (token == "movetime") {
             iss >> movetime;
         } else if (token == "nodes") {
@@ -111,6 +229,13 @@ static void cmd_go(std::string& cmd, Board& b) {
         }
     }
 
+    // The clock of the side to move (-1 if there isn't one)
+    TimeControl clock;
+    clock.remaining = b.to_move == WHITE ? wtime : btime;
+    clock.increment = b.to_move == WHITE ? winc : binc;
+    clock.moves_to_go = movestogo;
+    clock.move_overhead = move_overhead;
+
     SearchMode search_mode;
     if (movetime != -1) {
         search_mode = TIME;
@@ -121,35 +246,34 @@ static void cmd_go(std::string& cmd, Board& b) {
     } else if (infinite) {
         search_mode = INFINITE;
     } else {
-        // If we're not explicitly told how to search, then we attempt
-        // compute search time by looking at time controls
+        // If we're not explicitly told how to search, then the time manager decides
+        // how much of the clock to use
         search_mode = TIME;
 
         // Default time limit in milliseconds in case time controls
         // haven't been specified
-        movetime = 50;
-
-        // Determine how long to search for
-        if (b.to_move == WHITE && wtime != -1) {
-            movetime = calc_time_limit(wtime, winc);
-        } else if (b.to_move == BLACK && btime != -1) {
-            movetime = calc_time_limit(btime, binc);
+        if (clock.remaining == -1) {
+            movetime = 50;
         }
     }
 
     // Create new search thread and start the search
-    clean_up_thread();
-    search_thread = std::thread([&]() {
+    clean_up_thread(searcher);
+
+    // Capture the parsed limits by value since this function returns before the search ends
+    search_thread = std::thread([=, &b, &searcher]() {
         Move best_move;
 
-        if (search_mode == TIME) {
-            best_move = search_time(b, movetime);
+        if (search_mode == TIME && movetime == -1) {
+            best_move = searcher.search_clock(b, clock);
+        } else if (search_mode == TIME) {
+            best_move = searcher.search_time(b, movetime);
         } else if (search_mode == NODES) {
-            best_move = search_nodes(b, nodes);
+            best_move = searcher.search_nodes(b, nodes);
         } else if (search_mode == DEPTH) {
-            best_move = search_depth(b, depth);
+            best_move = searcher.search_depth(b, depth);
         } else if (search_mode == INFINITE) {
-            best_move = search_infinite(b);
+            best_move = searcher.search_infinite(b);
         }
 
         // Default no move/null move convention
@@ -174,12 +298,12 @@ static void cmd_ponderhit() {
     // TODO
 }
 
-static void cmd_stop() {
-    clean_up_thread();
+static void cmd_stop(Searcher& searcher) {
+    clean_up_thread(searcher);
 }
 
-static void cmd_quit() {
-    clean_up_thread();
+static void cmd_quit(Searcher& searcher) {
+    clean_up_thread(searcher);
 }
 
 void uci_loop() {
@@ -189,23 +313,24 @@ void uci_loop() {
     // Untie cin from cout to prevent automatic flushing (will be manually controlled)
     std::cin.tie(nullptr);
 
-    // Create board object
+    // Create board and searcher objects
     Board b;
+    Searcher searcher;
 
     std::string cmd;
     while (std::getline(std::cin, cmd)) {
         if (cmd == "uci") {
-            cmd_uci();
+            cmd_uci(searcher);
         } else if (cmd.starts_with("setoption")) {
-            cmd_setoption(cmd);
+            cmd_setoption(cmd, searcher);
         } else if (cmd == "isready") {
             cmd_isready();
         } else if (cmd == "ucinewgame") {
-            cmd_ucinewgame(b);
+            cmd_ucinewgame(b, searcher);
         } else if (cmd.starts_with("position")) {
             cmd_position(cmd, b);
         } else if (cmd.starts_with("go")) {
-            cmd_go(cmd, b);
+            cmd_go(cmd, b, searcher);
         } else if (cmd.starts_with("debug")) {
             cmd_debug();
         } else if (cmd == "register") {
@@ -213,12 +338,15 @@ void uci_loop() {
         } else if (cmd == "ponderhit") {
             cmd_ponderhit();
         } else if (cmd == "stop") {
-            cmd_stop();
+            cmd_stop(searcher);
         } else if (cmd == "quit") {
-            cmd_quit();
+            cmd_quit(searcher);
             break;
         } else {
             print("Unknown command: '" + cmd + "'");
         }
     }
+
+    // The GUI may close stdin without sending quit, and the search must not outlive the searcher
+    clean_up_thread(searcher);
 }
\ No newline at end of file